@@ -20,6 +20,7 @@
 */
 
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 
 #include <algorithm>
@@ -30,6 +31,9 @@
 
 #include "AStar2.hh"
 #include "AStarState.hh"
+#include "HashTable.hh"
+#include "LargeMemory.hh"
+#include "Problem.hh"
 #include "State.hh"
 #include "Statistics.hh"
 #include "parameters.hh"
@@ -43,60 +47,91 @@ using namespace std;
 // #states entries
 static const double LOAD_FACTOR = 1.4;
 
-static const unsigned int MAX_STATES = (unsigned int)
-    (MEMORY / (sizeof(int) * LOAD_FACTOR + sizeof(AStarState)));
-static const unsigned int MAX_HASHES = (unsigned int)
-    (MAX_STATES * LOAD_FACTOR);
+static size_t maxStates() {
+    return size_t(LargeMemory::budget()
+		  / (HashTable<AStarState>::BYTES_PER_SLOT * LOAD_FACTOR
+		     + sizeof(AStarState)));
+}
 
-vector<AStarState> states;
-vector<int> hashTable;
+// numbered from 1 in the order they were generated
+HashTable<AStarState> states("A* states");
 deque<Move> solution;
 
 static int maxMoves;		// cutoff
+static int nextMaxMoves;	// smallest f-value above the cutoff
 static int minMinTotalMoves;	// currently lowest f-value of an open state
-static int firstOpen;
-static int searchIndex;
-static int numOpen;
+static size_t firstOpen;
+static size_t searchIndex;
+static size_t numOpen;
 
 void hashInsert(const AStarState& state) {
-    unsigned int hash = state.hash() % hashTable.size();
-    while (true) {
-	if (hashTable[hash] == 0) { // found empty place?
-	    states.push_back(state);
-	    ++numOpen;
-	    hashTable[hash] = states.size() - 1;
+    bool isNew;
+    AStarState& oldState = *states.findOrInsert(state, isNew);
+    if (isNew) {
+	++numOpen;
+    } else if (state.numMoves < oldState.numMoves) {
+	// An important property of A* is that states that have already been
+	// expanded will never be re-expanded.
+	assert(oldState.isOpen);
+	oldState.numMoves = state.numMoves;
+	oldState.predecessor = state.predecessor;
+	// with the new g, its children need to be generated again
+	oldState.resetMinMovesLeft();
+	size_t nr = states.numberOf(oldState);
+	if (nr < firstOpen)
+	    firstOpen = nr;
+    }
+    // otherwise, we already know a better way
+}
 
-	    return;
-	} else {
-	    AStarState& oldState = states[hashTable[hash]];
-	    if (oldState == state) { // already known?
-		if (state.numMoves < oldState.numMoves) {
-		    // An important property of A* is that states that have
-		    // already been expanded will never be re-expanded.
-		    assert(oldState.isOpen);
-		    oldState.numMoves = state.numMoves;
-		    oldState.predecessor = state.predecessor;
-		    if (hashTable[hash] < firstOpen)
-			firstOpen = hashTable[hash];
-		    return;
-		} else {
-		    // we already know a better way
-		    return;
-		}
-	    }
-	    // hash collision; probe linearly for first free space.
-	    if (++hash >= hashTable.size())
-		hash = 0;
-	}
+#ifdef DO_PARTIAL_EXPANSION
+// The term of the estimate for the n identical atoms from first on, at
+// positions: the cheapest assignment of them to their goal fields.
+static int groupMinMoves(int first, const Pos* positions, int n) {
+    int perm[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+    int minMinMoves = INT_MAX;
+    do {
+	int minMoves = 0;
+	for (int j = 0; j < n; ++j)
+	    minMoves += Problem::goalDist(first + perm[j], positions[j]);
+	if (minMoves < minMinMoves)
+	    minMinMoves = minMoves;
+    } while (next_permutation(perm, perm + n));
+    return minMinMoves;
+}
+
+// The operator selection function of EPEA*: how much move changes the
+// estimate of state. Only the term of the moved atom's group of identical
+// atoms changes, so this is looked up in the goal distances of that group
+// alone, without building the child.
+static int minMovesLeftDelta(const AStarState& state, const Move& move) {
+    int atomNr = move.atomNr();
+    if (atomNr < NUM_UNIQUE)
+	return Problem::goalDist(atomNr, move.pos2())
+	    - Problem::goalDist(atomNr, move.pos1());
+    int first = PAIRED_START + (atomNr - PAIRED_START) / 2 * 2;
+    int n = 2;
+    if (atomNr >= MULTI_START) {
+	for (first = MULTI_START;
+	     first + Problem::numIdentical(first) <= atomNr;
+	     first += Problem::numIdentical(first)) { }
+	n = Problem::numIdentical(first);
     }
+    Pos positions[16];
+    for (int j = 0; j < n; ++j)
+	positions[j] = state.atomPosition(first + j);
+    int before = groupMinMoves(first, positions, n);
+    positions[atomNr - first] = move.pos2();
+    return groupMinMoves(first, positions, n) - before;
 }
+#endif
 
-int findBest(int maxMoves) {
+size_t findBest(int maxMoves) {
     ++searchIndex;
     while (true) {
 	bool alreadyRestarted = false;
 	while (true) {
-	    for (; searchIndex < states.size(); ++searchIndex) {
+	    for (; searchIndex <= states.size(); ++searchIndex) {
 		if (states[searchIndex].isOpen
 		    && (states[searchIndex].minTotalMoves()
 			<= minMinTotalMoves)) {
@@ -109,9 +144,9 @@ int findBest(int maxMoves) {
 	    if (alreadyRestarted) // already twice?
 		break;
 	    // find first open state
-	    for (; firstOpen < states.size() && !states[firstOpen].isOpen;
+	    for (; firstOpen <= states.size() && !states[firstOpen].isOpen;
 		 ++firstOpen) { }
-	    if (firstOpen == states.size()) {
+	    if (firstOpen > states.size()) {
 		// no open nodes left at all...
 		return 0;
 	    }
@@ -127,20 +162,21 @@ int findBest(int maxMoves) {
     }
 }
 
-deque<Move> aStar2(const State& startState, int nmaxMoves) {
+deque<Move> aStar2(const State& startState, int nmaxMoves,
+		   int* nextMaxDist) {
     AStarState start = startState;
     maxMoves = nmaxMoves;
-    if (start.minTotalMoves() > maxMoves)
+    if (start.minTotalMoves() > maxMoves) {
+	if (nextMaxDist != NULL)
+	    *nextMaxDist = start.minTotalMoves();
 	return deque<Move>();	// saves the allocations which can take quite
 				// some time
+    }
 
-    states.clear();
-    states.push_back(AStarState()); // 0 reserved for 'empty'
-    states.reserve(MAX_STATES);
-    hashTable.clear();
-    hashTable.resize(MAX_HASHES);
+    states.clear(maxStates(), LOAD_FACTOR);
 
     minMinTotalMoves = 0;
+    nextMaxMoves = INT_MAX;
     firstOpen = 1;		// 0 reserved for 'empty'
     searchIndex = firstOpen;
     numOpen = 0;
@@ -151,17 +187,44 @@ deque<Move> aStar2(const State& startState, int nmaxMoves) {
 
     Statistics::timer.start();
     while (true) {
-	int bestIndex = findBest(maxMoves);
+	size_t bestIndex = findBest(maxMoves);
 	if (bestIndex == 0)	// no open state left
 	    break;
+#ifndef DO_PARTIAL_EXPANSION
 	states[bestIndex].isOpen = false;
 	--numOpen;
+#endif
 
 	vector<Move> moves = states[bestIndex].moves();
 	++Statistics::statesExpanded;
+#ifdef DO_PARTIAL_EXPANSION
+	// Only the moves that raise f by the difference between the stored
+	// and the real f of the state are made now. The others were made
+	// before, or will be when the state comes up again with the next
+	// larger change.
+	int realMinTotalMoves = states[bestIndex].numMoves
+	    + states[bestIndex].State::minMovesLeft();
+	int targetDeltaF = states[bestIndex].minTotalMoves()
+	    - realMinTotalMoves;
+	int nextDeltaF = INT_MAX;
+	vector<int> deltaF(moves.size());
+	for (size_t i = 0; i < moves.size(); ++i) {
+	    deltaF[i] = 1 + minMovesLeftDelta(states[bestIndex], moves[i]);
+	    if (deltaF[i] > targetDeltaF && deltaF[i] < nextDeltaF)
+		nextDeltaF = deltaF[i];
+	}
+	int nextMinTotalMoves = nextDeltaF == INT_MAX ? INT_MAX
+	    : realMinTotalMoves + nextDeltaF;
+#else
 	Statistics::numChildren += moves.size();
+#endif
 	for (vector<Move>::const_iterator m = moves.begin();
 	     m != moves.end(); ++m) {
+#ifdef DO_PARTIAL_EXPANSION
+	    if (deltaF[m - moves.begin()] != targetDeltaF)
+		continue;
+	    ++Statistics::numChildren;
+#endif
 	    ++Statistics::statesGenerated;
 	    // % is extremely slow on int64_t...
 	    if ((Statistics::statesGenerated & 0xffffff) == 0) {
@@ -169,10 +232,10 @@ deque<Move> aStar2(const State& startState, int nmaxMoves) {
 		     << "\n  open: " << numOpen
 		     << "\nstates: " << states.size()
 		     << " \t(" << (states.size() * sizeof(AStarState)) / 1000000
-		     << "M/" << (states.capacity() * sizeof(AStarState)) / 1000000
-		     << "M)\nhashes: " << hashTable.size()
-		     << " \t(" << (states.size() * sizeof(int)) / 1000000
-		     << "M/" << (hashTable.capacity() * sizeof(int)) / 1000000
+		     << "M/" << (maxStates() * sizeof(AStarState)) / 1000000
+		     << "M)\nhashes: " << states.numSlots()
+		     << " \t(" << states.numSlots()
+			* HashTable<AStarState>::BYTES_PER_SLOT / 1000000
 		     << ")\n";
 		Statistics::print(cout);
 	    }
@@ -185,10 +248,10 @@ deque<Move> aStar2(const State& startState, int nmaxMoves) {
 		cout << "Found solution.\n"
 		     << "\nstates: " << states.size()
 		     << " \t(" << (states.size() * sizeof(AStarState)) / 1000000
-		     << "M/" << (states.capacity() * sizeof(AStarState)) / 1000000
-		     << "M)\nhashes: " << hashTable.size()
-		     << " \t(" << (states.size() * sizeof(int)) / 1000000
-		     << "M/" << (hashTable.capacity() * sizeof(int)) / 1000000
+		     << "M/" << (maxStates() * sizeof(AStarState)) / 1000000
+		     << "M)\nhashes: " << states.numSlots()
+		     << " \t(" << states.numSlots()
+			* HashTable<AStarState>::BYTES_PER_SLOT / 1000000
 		     << "M)\n";
 		Statistics::print(cout);
 		AStarState* pNode = &states[bestIndex];
@@ -218,13 +281,15 @@ deque<Move> aStar2(const State& startState, int nmaxMoves) {
 	    }
 	    if (newState.minTotalMoves() > maxMoves) {
 		DEBUG0("State exceeds move limit.");
+		if (newState.minTotalMoves() < nextMaxMoves)
+		    nextMaxMoves = newState.minTotalMoves();
 		continue;
 	    }
 
 	    // we have a monotone heuristic
 	    assert(newState.minTotalMoves() >= minMinTotalMoves);
 
-	    if (states.size() == MAX_STATES) {
+	    if (states.capacityLeft() == 0) {
 		DEBUG1("State table full.");
 		exit(1);
 	    }
@@ -232,11 +297,23 @@ deque<Move> aStar2(const State& startState, int nmaxMoves) {
 	    hashInsert(newState);
 	    DEBUG0("inserted" << newState);
 	}
+#ifdef DO_PARTIAL_EXPANSION
+	if (nextMinTotalMoves <= maxMoves) {
+	    states[bestIndex].setMinTotalMoves(nextMinTotalMoves);
+	} else {
+	    if (nextMinTotalMoves < nextMaxMoves)
+		nextMaxMoves = nextMinTotalMoves;
+	    states[bestIndex].isOpen = false;
+	    --numOpen;
+	}
+#endif
     }
 
     DEBUG1("Queue empty; no solution possible.");
 
     Statistics::timer.stop();
+    if (nextMaxDist != NULL)
+	*nextMaxDist = nextMaxMoves;
     return deque<Move>();
 }
 
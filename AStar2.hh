@@ -28,8 +28,23 @@ class State;
 
 #include "Move.hh"
 
-std::deque<Move> aStar2(const State& start, int maxDist);
-
-#define ALGORITHM_NAME "astar"
+// Like IDAStar(): nextMaxDist is set to the smallest f-value above maxDist
+// that was cut off if no solution is found.
+std::deque<Move> aStar2(const State& start, int maxDist,
+			int* nextMaxDist = NULL);
+
+// Enhanced partial expansion [Felner et al. 2012]: only the children whose
+// f equals the f of the expanded state are generated; the state stays open
+// with the next larger f of its children. Which moves those are is told by
+// how much each changes the estimate, which is looked up in the goal
+// distances without building the child.
+//#undef DO_PARTIAL_EXPANSION
+#define DO_PARTIAL_EXPANSION 1
+
+#ifdef DO_PARTIAL_EXPANSION
+# define ALGORITHM_NAME "astar-epea"
+#else
+# define ALGORITHM_NAME "astar"
+#endif
 
 #endif
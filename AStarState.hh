@@ -22,6 +22,8 @@
 #ifndef ASTARSTATE_HH
 #define ASTARSTATE_HH
 
+#include "stdint.h"
+
 class Move;
 
 #include "Size.hh"
@@ -39,7 +41,12 @@ public:
     // overrides State::minTotalMoves()!
     int minTotalMoves() const { return numMoves + minMovesLeft_; }
 
-    int predecessor;
+    // for partial expansion: pretend the estimate is higher, so that
+    // minTotalMoves() is f, or go back to the real one
+    void setMinTotalMoves(int f) { minMovesLeft_ = f - numMoves; }
+    void resetMinMovesLeft() { calcMinMovesLeft(); }
+
+    uint64_t predecessor;	// its number in the state table
 
 private:
     void calcMinMovesLeft() { minMovesLeft_ = State::minMovesLeft(); }
@@ -0,0 +1,192 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "BeamSearch.hh"
+#include "CacheState.hh"
+#include "HashTable.hh"
+#include "Problem.hh"
+#include "Statistics.hh"
+
+using namespace std;
+
+// a state in a layer of the beam, and how it was reached
+class BeamNode : public CacheState {
+public:
+    // leave uninitialized
+    BeamNode() { }
+    BeamNode(const CacheState& state, int parentNr, const Move& nmove)
+	: CacheState(state), move(nmove), parent(parentNr),
+	  minMovesLeft(state.minMovesLeft()) { }
+
+    Move move;			// in the atom numbering of the parent
+    int parent;			// index in the previous layer
+    int minMovesLeft;
+};
+
+// work for one thread: expand layer[begin..end), but stop with full set
+// once there are maxChildren children
+struct Expansion {
+    const vector<BeamNode>* layer;
+    size_t begin, end;
+    size_t maxChildren;
+    bool full;
+    vector<BeamNode> children;
+};
+
+static void* expand(void* arg) {
+    Expansion& expansion = *static_cast<Expansion*>(arg);
+    const vector<BeamNode>& layer = *expansion.layer;
+    for (size_t i = expansion.begin; i < expansion.end; ++i) {
+	vector<Move> moves = layer[i].moves();
+	for (vector<Move>::const_iterator m = moves.begin();
+	     m != moves.end(); ++m) {
+	    if (expansion.children.size() == expansion.maxChildren) {
+		expansion.full = true;
+		return NULL;
+	    }
+	    expansion.children.push_back(
+		BeamNode(CacheState(layer[i], *m), i, *m));
+	}
+    }
+    return NULL;
+}
+
+static bool betterNode(const BeamNode& a, const BeamNode& b) {
+    return a.minMovesLeft < b.minMovesLeft;
+}
+
+// Follow the parents back from node in layers[depth], and turn the moves
+// into the atom numbering of the start state.
+static deque<Move> solutionTo(const vector<vector<BeamNode> >& layers,
+			      int depth, const BeamNode& node) {
+    deque<Move> canonicalMoves;
+    canonicalMoves.push_front(node.move);
+    for (int parent = node.parent; depth > 0; --depth) {
+	const BeamNode& p = layers[depth][parent];
+	canonicalMoves.push_front(p.move);
+	parent = p.parent;
+    }
+
+    return uncanonicalMoves(canonicalMoves);
+}
+
+deque<Move> beamSearch(int width, int maxLength, size_t memory,
+		       int numThreads) {
+    vector<vector<BeamNode> > layers(1);
+    CacheState start(State(Problem::startPositions()));
+    layers[0].push_back(BeamNode(start, -1, Move()));
+    if (start.minMovesLeft() == 0)
+	return deque<Move>();
+
+    // the layers before, to recognize moving back
+    HashTable<BeamNode> seen[2];
+    seen[0].insertNew(layers[0][0]);
+    size_t layerBytes = sizeof(BeamNode);
+
+    vector<Expansion> expansions(numThreads);
+    vector<pthread_t> threads(numThreads);
+    Statistics::timer.start();
+    for (int depth = 0; depth < maxLength; ++depth) {
+	const vector<BeamNode>& layer = layers[depth];
+	Statistics::statesExpanded += layer.size();
+	// the children and their hash table, kept with the next layer, have
+	// to fit into what the layers so far leave; each thread gets its share
+	size_t maxChildren = layerBytes < memory
+	    ? (memory - layerBytes) / (3 * sizeof(BeamNode)) : 0;
+	for (int t = 0; t < numThreads; ++t) {
+	    Expansion& expansion = expansions[t];
+	    expansion.layer = &layer;
+	    expansion.begin = layer.size() * t / numThreads;
+	    expansion.end = layer.size() * (t + 1) / numThreads;
+	    expansion.maxChildren = maxChildren / numThreads;
+	    expansion.full = false;
+	    expansion.children.clear();
+	    if (pthread_create(&threads[t], NULL, expand, &expansion) != 0)
+		throw runtime_error("cannot create thread");
+	}
+	size_t numChildren = 0;
+	bool full = false;
+	for (int t = 0; t < numThreads; ++t) {
+	    pthread_join(threads[t], NULL);
+	    numChildren += expansions[t].children.size();
+	    full |= expansions[t].full;
+	}
+	Statistics::statesGenerated += numChildren;
+	Statistics::numChildren += numChildren;
+
+	if (full) {
+	    cout << "Beam search out of memory at depth " << depth << endl;
+	    break;
+	}
+
+	HashTable<BeamNode>& next = seen[(depth + 1) % 2];
+	HashTable<BeamNode>& current = seen[depth % 2];
+	HashTable<BeamNode> children(numChildren, 1.5);
+	for (int t = 0; t < numThreads; ++t) {
+	    const vector<BeamNode>& c = expansions[t].children;
+	    for (vector<BeamNode>::const_iterator child = c.begin();
+		 child != c.end(); ++child) {
+		if (child->minMovesLeft == 0) {
+		    Statistics::timer.stop();
+		    return solutionTo(layers, depth, *child);
+		}
+		if (children.find(*child) == NULL
+		    && current.find(*child) == NULL
+		    && next.find(*child) == NULL)
+		    children.insertNew(*child);
+	    }
+	}
+	if (children.size() == 0)
+	    break;
+
+	layers.push_back(vector<BeamNode>(children.begin(), children.end()));
+	vector<BeamNode>& newLayer = layers.back();
+	if (int(newLayer.size()) > width) {
+	    nth_element(newLayer.begin(), newLayer.begin() + width,
+			newLayer.end(), betterNode);
+	    newLayer.resize(width);
+	}
+	vector<BeamNode>(newLayer).swap(newLayer);	// shrink to fit
+	layerBytes += newLayer.size() * sizeof(BeamNode);
+
+	// next now holds the layer before the current one; replace it
+	next.clear(newLayer.size());
+	for (vector<BeamNode>::const_iterator n = newLayer.begin();
+	     n != newLayer.end(); ++n)
+	    next.insertNew(*n);
+
+	if ((depth & 7) == 7)
+	    cout << "Beam depth " << depth + 1 << ": best estimate "
+		 << min_element(newLayer.begin(), newLayer.end(),
+				betterNode)->minMovesLeft
+		 << " moves left" << endl;
+    }
+    Statistics::timer.stop();
+
+    return deque<Move>();
+}
@@ -0,0 +1,41 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#ifndef BEAMSEARCH_HH
+#define BEAMSEARCH_HH
+
+#include <stddef.h>
+
+#include <deque>
+
+#include "Move.hh"
+
+// Beam search for the current goal of Problem: breadth-first, but only the
+// width states with the smallest heuristic estimate of each layer are kept.
+// Duplicates within a layer, and of the two layers before, are removed.
+// Layers are expanded by numThreads threads. Finds solutions quickly, but
+// not necessarily short ones. Gives up when a solution would need more
+// than maxLength moves, or when the layers would take more than memory
+// bytes.
+deque<Move> beamSearch(int width, int maxLength, size_t memory,
+		       int numThreads);
+
+#endif
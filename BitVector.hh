@@ -24,7 +24,8 @@
 
 #include "stdint.h"
 #include <assert.h>
-#include <string.h>
+
+#include "LargeMemory.hh"
 
 // unfortunately, vector<bool> has no operator[](uint64_t), so it is limited
 // to half a gig of memory. So we have to do it ourselves for 32-bit
@@ -34,21 +35,21 @@ class BitVector {
 public:
     BitVector(uint64_t numBits = 0) {
 	bits = NULL;
+	numLimbs = 0;
 	init(numBits);
     }
 
     void init(uint64_t numBits) {
-	delete[] bits;
+	LargeMemory::release(bits, numLimbs * sizeof *bits, "partial bits");
 	numBits_ = numBits;
 	numLimbs = (numBits_ + BITS_PER_ULONG - 1) / BITS_PER_ULONG;
-	bits = new unsigned long[numLimbs];
-#ifdef MY_OS_ZEROES_LARGE_MEMORY_ALLOCATIONS
-	if (numBits / 8 < 65536)
-#endif
-	    memset(bits, 0, numBits / 8);
+	bits = static_cast<unsigned long*>(
+	    LargeMemory::allocate(numLimbs * sizeof *bits, "partial bits"));
     }
 
-    ~BitVector() { delete[] bits; }
+    ~BitVector() {
+	LargeMemory::release(bits, numLimbs * sizeof *bits, "partial bits");
+    }
 
     uint64_t numBits() const { return numBits_; }
 
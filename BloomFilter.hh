@@ -0,0 +1,104 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#ifndef BLOOMFILTER_HH
+#define BLOOMFILTER_HH
+
+#include "stdint.h"
+
+#include "LargeMemory.hh"
+
+// A blocked Bloom filter: the key's block of 512 bits, one cache line, is
+// chosen by one hash, and the K bits within it by another, so a lookup costs
+// a single cache miss. Blocks are picked by multiply-shift instead of
+// modulo. K can be at most 7, as each bit takes 9 bits of one 64-bit hash.
+// The same block hash with different bit hashes stays in the same line,
+// which callers can use to look up related keys together.
+
+template<int K>
+class BloomFilter {
+public:
+    BloomFilter() : blocks(NULL), numBlocks(0) { }
+    ~BloomFilter() {
+	LargeMemory::release(blocks, numBlocks * (BLOCK_BITS / 8),
+			     "partial bits");
+    }
+
+    void init(uint64_t numBits) {
+	LargeMemory::release(blocks, numBlocks * (BLOCK_BITS / 8),
+			     "partial bits");
+	numBlocks = numBits / BLOCK_BITS;
+	blocks = static_cast<uint64_t*>(
+	    LargeMemory::allocate(numBlocks * (BLOCK_BITS / 8),
+				  "partial bits"));
+    }
+
+    uint64_t numBits() const { return numBlocks * BLOCK_BITS; }
+
+    bool contains(uint64_t blockHash, uint64_t bitHash) const {
+	const uint64_t* block = this->block(blockHash);
+	uint64_t x = mix(bitHash);
+	for (int i = 0; i < K; ++i, x >>= 9)
+	    if (!(block[(x >> 6) & 7] & (1UL << (x & 63))))
+		return false;
+	return true;
+    }
+
+    // returns the number of bits that were not set before
+    int insert(uint64_t blockHash, uint64_t bitHash) {
+	uint64_t* block = this->block(blockHash);
+	uint64_t x = mix(bitHash);
+	int newBits = 0;
+	for (int i = 0; i < K; ++i, x >>= 9) {
+	    uint64_t& word = block[(x >> 6) & 7];
+	    uint64_t bit = 1UL << (x & 63);
+	    newBits += !(word & bit);
+	    word |= bit;
+	}
+	return newBits;
+    }
+
+private:
+    BloomFilter(const BloomFilter&); // copying not allowed
+
+    static const int BLOCK_BITS = 512;
+
+    // MurmurHash3's finalizer; each probe uses 9 bits of it
+    static uint64_t mix(uint64_t x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+    }
+
+    uint64_t* block(uint64_t hash) const {
+	// the high bits decide, and not every hash function fills them well
+	uint64_t nr = (unsigned __int128) mix(hash) * numBlocks >> 64;
+	return blocks + nr * (BLOCK_BITS / 64);
+    }
+
+    uint64_t* blocks;
+    uint64_t numBlocks;
+};
+
+#endif
@@ -0,0 +1,184 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "BoundsDatabase.hh"
+#include "Level.hh"
+
+using namespace std;
+
+// Line format:
+// <level hash> <level name> <goal pos> <lower bound> <seconds> <states>
+// <solution length> <solution moves...>
+
+BoundsDatabase::BoundsDatabase(const string& fileName, const Level& level,
+			       const string& levelName)
+    : myFileName(fileName), myLevelName(levelName),
+      myLevelHash(level.hash()) {
+    if (levelName.find_first_of(" \t\n\r\v\f") != string::npos)
+	throw runtime_error("level name \"" + levelName
+			    + "\" contains white space");
+    deque<string> otherLines;
+    read(myEntries, otherLines);
+}
+
+void BoundsDatabase::reload() {
+    deque<string> otherLines;
+    myEntries.clear();
+    read(myEntries, otherLines);
+}
+
+const BoundsEntry& BoundsDatabase::entry(Pos goalPos) const {
+    static const BoundsEntry unknown;
+    Entries::const_iterator e = myEntries.find(goalPos);
+    return e == myEntries.end() ? unknown : e->second;
+}
+
+void BoundsDatabase::read(Entries& entries, deque<string>& otherLines) const {
+    ifstream in(myFileName.c_str());
+    string line;
+    while (getline(in, line)) {
+	istringstream lineStream(line);
+	uint64_t hash;
+	string name;
+	Pos goalPos;
+	BoundsEntry entry;
+	size_t length;
+	if (!(lineStream >> hex >> hash >> dec)) {
+	    if (!line.empty())
+		otherLines.push_back(line);
+	    continue;
+	}
+	if (hash != myLevelHash) {
+	    otherLines.push_back(line);
+	    continue;
+	}
+	lineStream >> name >> goalPos >> entry.lowerBound >> entry.seconds
+		   >> entry.statesGenerated >> length;
+	for (size_t i = 0; i < length && lineStream; ++i) {
+	    Move move;
+	    if (lineStream >> move)
+		entry.solution.push_back(move);
+	}
+	if (!lineStream) {
+	    cerr << "Warning: ignoring malformed line in " << myFileName
+		 << ": " << line << endl;
+	    continue;
+	}
+	entries[goalPos] = entry;
+    }
+}
+
+// An exclusive lock on a file, held until it goes out of scope, so that it
+// is also released when update() throws.
+class FileLock {
+public:
+    FileLock(const string& fileName) {
+	fd = open(fileName.c_str(), O_RDWR | O_CREAT, 0666);
+	if (fd < 0 || flock(fd, LOCK_EX) != 0) {
+	    string error = strerror(errno);
+	    if (fd >= 0)
+		close(fd);
+	    throw runtime_error("cannot lock " + fileName + ": " + error);
+	}
+    }
+    ~FileLock() {
+	// closing the last descriptor releases the lock
+	close(fd);
+    }
+
+private:
+    FileLock(const FileLock&); // copying not allowed
+    int fd;
+};
+
+void BoundsDatabase::update(Pos goalPos, int lowerBound,
+			    const deque<Move>& solution,
+			    double seconds, uint64_t statesGenerated) {
+    FileLock lock(myFileName + ".lock");
+
+    // somebody else may have written since we last looked
+    myEntries.clear();
+    deque<string> otherLines;
+    read(myEntries, otherLines);
+
+    BoundsEntry& entry = myEntries[goalPos];
+    if (lowerBound > entry.lowerBound)
+	entry.lowerBound = lowerBound;
+    if (!solution.empty() && (entry.solution.empty()
+			      || solution.size() < entry.solution.size()))
+	entry.solution = solution;
+    entry.seconds += seconds;
+    entry.statesGenerated += statesGenerated;
+
+    ostringstream tmpName;
+    tmpName << myFileName << ".tmp." << getpid();
+    {
+	ofstream out(tmpName.str().c_str());
+	for (deque<string>::const_iterator l = otherLines.begin();
+	     l != otherLines.end(); ++l)
+	    out << *l << '\n';
+	for (Entries::const_iterator e = myEntries.begin();
+	     e != myEntries.end(); ++e) {
+	    const BoundsEntry& entry = e->second;
+	    out << hex << myLevelHash << dec << ' ' << myLevelName << ' '
+		<< e->first << ' ' << entry.lowerBound << ' '
+		<< entry.seconds << ' ' << entry.statesGenerated << ' '
+		<< entry.solution.size();
+	    for (deque<Move>::const_iterator m = entry.solution.begin();
+		 m != entry.solution.end(); ++m)
+		out << ' ' << *m;
+	    out << '\n';
+	}
+	out.flush();
+	if (!out) {
+	    unlink(tmpName.str().c_str());
+	    throw runtime_error("cannot write " + tmpName.str());
+	}
+    }
+    // on disk before it replaces the old version, so that a crash cannot
+    // leave an empty or partial file behind
+    int fd = open(tmpName.str().c_str(), O_RDONLY);
+    if (fd < 0 || fsync(fd) != 0) {
+	string error = strerror(errno);
+	if (fd >= 0)
+	    close(fd);
+	unlink(tmpName.str().c_str());
+	throw runtime_error("cannot sync " + tmpName.str() + ": " + error);
+    }
+    close(fd);
+    if (rename(tmpName.str().c_str(), myFileName.c_str()) != 0) {
+	string error = strerror(errno);
+	unlink(tmpName.str().c_str());
+	throw runtime_error("cannot rename " + tmpName.str() + ": " + error);
+    }
+}
@@ -0,0 +1,82 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#ifndef BOUNDSDATABASE_HH
+#define BOUNDSDATABASE_HH
+
+#include "stdint.h"
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include "Move.hh"
+#include "Pos.hh"
+
+class Level;
+
+// What is known about one goal position of a level.
+struct BoundsEntry {
+    BoundsEntry() : lowerBound(0), seconds(0), statesGenerated(0) { }
+
+    int lowerBound;		// proven: no shorter solution exists
+    deque<Move> solution;	// best one known; empty if none
+    double seconds;		// CPU time spent on this goal so far
+    uint64_t statesGenerated;	// ditto, in states
+};
+
+// On-disk store of bounds, solutions and effort, so that runs can pick up
+// where earlier ones stopped. The file holds one line per (level, goal),
+// where levels are identified by Level::hash(). Updates take an exclusive
+// lock on "<file>.lock", merge with the current contents, and rename a new
+// version into place, so several solvers can share one file and readers
+// never see a partial one. The fields are separated by white space, which
+// is why level names must not contain any; atomixer-batch reads the same
+// format.
+class BoundsDatabase {
+public:
+    // throws runtime_error if levelName contains white space
+    BoundsDatabase(const string& fileName, const Level& level,
+		   const string& levelName);
+
+    // as of construction or the last update() or reload()
+    const BoundsEntry& entry(Pos goalPos) const;
+
+    // pick up what others wrote meanwhile
+    void reload();
+
+    // Merge new knowledge about a goal: the lower bound is raised, the
+    // solution replaced if shorter, and the effort added.
+    void update(Pos goalPos, int lowerBound, const deque<Move>& solution,
+		double seconds, uint64_t statesGenerated);
+
+private:
+    typedef map<Pos, BoundsEntry> Entries;
+
+    // parse the current file; lines for other levels are kept verbatim
+    void read(Entries& entries, deque<string>& otherLines) const;
+
+    string myFileName, myLevelName;
+    uint64_t myLevelHash;
+    Entries myEntries;
+};
+
+#endif
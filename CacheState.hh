@@ -22,6 +22,10 @@
 #ifndef CACHESTATE_HH
 #define CACHESTATE_HH
 
+#include <assert.h>
+
+#include <deque>
+
 #include "Pos.hh"
 #include "Problem.hh"
 #include "State.hh"
@@ -45,6 +49,9 @@ private:
     }
     // if only one atom changed, we can do it faster.
     void canonicallify(int atomNr) {
+	// also lets the compiler see that the swaps stay within
+	// atomPositions_
+	assert(atomNr >= 0 && atomNr < NUM_ATOMS);
 	if (atomNr >= PAIRED_START && atomNr < PAIRED_END) {
 	    if ((atomNr - PAIRED_START) % 2 == 0) {
 		if (atomPositions_[atomNr + 1] < atomPositions_[atomNr])
@@ -83,4 +90,23 @@ private:
     void undo(const Move& move); // not easily implementable
 } __attribute__ ((packed));
 
+// Turn moves from the start state that were made on CacheStates, where
+// identical atoms get renumbered, into the atom numbering of the start
+// state.
+inline deque<Move> uncanonicalMoves(const deque<Move>& canonicalMoves) {
+    deque<Move> moves;
+    Pos positions[NUM_ATOMS];
+    for (int i = 0; i < NUM_ATOMS; ++i)
+	positions[i] = Problem::startPosition(i);
+    for (deque<Move>::const_iterator m = canonicalMoves.begin();
+	 m != canonicalMoves.end(); ++m) {
+	int atomNr = 0;
+	while (positions[atomNr] != m->pos1())
+	    ++atomNr;
+	positions[atomNr] = m->pos2();
+	moves.push_back(Move(atomNr, m->pos1(), m->pos2(), m->dir()));
+    }
+    return moves;
+}
+
 #endif
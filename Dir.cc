@@ -39,3 +39,17 @@ ostream& operator <<(ostream& out, Dir dir) {
 	return out << '?';
     }
 }
+
+istream& operator >>(istream& in, Dir& dir) {
+    char c;
+    if (in >> c) {
+	switch(c) {
+	case 'u': dir = UP; break;
+	case 'd': dir = DOWN; break;
+	case 'l': dir = LEFT; break;
+	case 'r': dir = RIGHT; break;
+	default: in.setstate(ios::failbit);
+	}
+    }
+    return in;
+}
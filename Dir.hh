@@ -33,6 +33,7 @@ using namespace std;
 enum Dir { NONE = 0, UP = -XSIZE, DOWN = XSIZE, LEFT = -1, RIGHT = 1 };
 
 ostream& operator <<(ostream& out, Dir dir);
+istream& operator >>(istream& in, Dir& dir);
 
 static const Dir DIRS[4] = { UP, DOWN, LEFT, RIGHT };
 
@@ -0,0 +1,119 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "DiskCache.hh"
+
+using namespace std;
+
+static const size_t BUCKET_BYTES = 4096;
+static const int BUCKET_ENTRIES = BUCKET_BYTES / sizeof(DiskCacheEntry);
+
+// DiskCacheEntry::iteration for an iteration with maxMoves; never 0
+static inline uint8_t tag(int maxMoves) {
+    return maxMoves % 255 + 1;
+}
+
+DiskCacheEntry* DiskCache::myEntries;
+uint64_t DiskCache::mySize;
+uint64_t DiskCache::myNumBuckets;
+int DiskCache::myFd = -1;
+
+void DiskCache::open(const char* fileName, uint64_t size) {
+    myNumBuckets = size / BUCKET_BYTES;
+    mySize = myNumBuckets * BUCKET_BYTES;
+    myFd = ::open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (myFd < 0)
+	throw runtime_error(string("cannot create disk cache ") + fileName);
+    unlink(fileName);
+    if (ftruncate(myFd, mySize) != 0)
+	throw runtime_error(string("cannot size disk cache ") + fileName);
+    void* p = mmap(NULL, mySize, PROT_READ | PROT_WRITE, MAP_SHARED, myFd, 0);
+    if (p == MAP_FAILED)
+	throw runtime_error(string("cannot map disk cache ") + fileName);
+    myEntries = static_cast<DiskCacheEntry*>(p);
+    madvise(myEntries, mySize, MADV_RANDOM);
+}
+
+void DiskCache::clear() {
+    // dropping the blocks is much faster than writing zeroes
+    if (ftruncate(myFd, 0) != 0 || ftruncate(myFd, mySize) != 0)
+	throw runtime_error("cannot clear disk cache");
+}
+
+DiskCacheEntry* DiskCache::bucket(const CacheState& state) {
+    return myEntries + (state.hash64_1() % myNumBuckets) * BUCKET_ENTRIES;
+}
+
+void DiskCache::prefetch(const CacheState& state) {
+    madvise(bucket(state), BUCKET_BYTES, MADV_WILLNEED);
+}
+
+bool DiskCache::find(const CacheState& state, int maxMoves,
+		     IDAStarCacheState& entry) {
+    DiskCacheEntry* b = bucket(state);
+    uint8_t current = tag(maxMoves);
+    for (int i = 0; i < BUCKET_ENTRIES && b[i].iteration != 0; ++i) {
+	if (b[i] == state) {
+	    entry = b[i];
+	    if (b[i].iteration != current)
+		entry.minMovesFromStart = 255;
+	    return true;
+	}
+    }
+    return false;
+}
+
+void DiskCache::store(const IDAStarCacheState& state, int maxMoves) {
+    DiskCacheEntry* b = bucket(state);
+    uint8_t current = tag(maxMoves);
+    int victim = 0;
+    for (int i = 0; i < BUCKET_ENTRIES; ++i) {
+	if (b[i].iteration == 0) {
+	    victim = i;
+	    break;
+	}
+	if (b[i] == state) {
+	    if (b[i].iteration != current) {
+		b[i].minMovesFromStart = state.minMovesFromStart;
+		b[i].iteration = current;
+	    }
+	    b[i].update(state);
+	    return;
+	}
+	// prefer entries from old iterations, then those deepest in the tree,
+	// whose subtrees are smallest
+	bool stale = b[i].iteration != current;
+	bool victimStale = b[victim].iteration != current;
+	if (stale > victimStale
+	    || (stale == victimStale
+		&& b[i].minMovesFromStart > b[victim].minMovesFromStart))
+	    victim = i;
+    }
+    static_cast<IDAStarCacheState&>(b[victim]) = state;
+    b[victim].iteration = current;
+}
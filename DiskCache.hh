@@ -0,0 +1,70 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#ifndef DISKCACHE_HH
+#define DISKCACHE_HH
+
+#include "stdint.h"
+
+#include "IDAStarCacheState.hh"
+
+// A second tier for the transposition table of IDAStar: a fixed-size table
+// in a memory-mapped file, meant to live on a local SSD, for states close to
+// the root, where a hit saves a subtree large enough to pay for the latency.
+// Each bucket is one page, so a probe reads at most one page. prefetch()
+// starts reading a bucket in the background when a state is generated, so
+// that the probe when it is expanded usually finds it in memory.
+//
+// minMovesLeft is valid for the whole goal; minMovesFromStart only for the
+// iteration it was stored in, which is tagged with maxMoves, so that
+// nothing has to be touched between iterations. The tag repeats every 255
+// iterations, more than the moves a path can have (see minMovesFromStart).
+
+struct DiskCacheEntry : public IDAStarCacheState {
+    uint8_t iteration;		// tag(maxMoves) when stored, 0 if empty
+} __attribute__ ((packed));
+
+class DiskCache {
+public:
+    // Map a table of size bytes in fileName, which is removed right away.
+    static void open(const char* fileName, uint64_t size);
+    static bool isOpen() { return myEntries != NULL; }
+    static void clear();
+
+    static void prefetch(const CacheState& state);
+    // Look up state; an entry from an earlier iteration comes back with
+    // minMovesFromStart 255.
+    static bool find(const CacheState& state, int maxMoves,
+		     IDAStarCacheState& entry);
+    // Merge state into the table, replacing the entry least worth keeping
+    // if its bucket is full.
+    static void store(const IDAStarCacheState& state, int maxMoves);
+
+private:
+    static DiskCacheEntry* bucket(const CacheState& state);
+
+    static DiskCacheEntry* myEntries;
+    static uint64_t mySize;
+    static uint64_t myNumBuckets;
+    static int myFd;
+};
+
+#endif
@@ -0,0 +1,414 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+
+#include <errno.h>
+#include <limits.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "Distributed.hh"
+#include "IDAStar.hh"
+#include "Level.hh"
+#include "Problem.hh"
+#include "SharedBounds.hh"
+#include "Statistics.hh"
+#include "parameters.hh"
+
+using namespace std;
+
+// how often the coordinator looks at the bounds while waiting, in
+// milliseconds
+static const int POLL_INTERVAL = 100;
+// how long a worker tries to reach a coordinator that is still starting up,
+// in seconds
+static const int CONNECT_TIMEOUT = 60;
+
+static void sendLine(int fd, const string& line) {
+    string data = line + '\n';
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+	ssize_t n = send(fd, p, left, MSG_NOSIGNAL);
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n <= 0)
+	    return;		// the reader notices the lost connection
+	p += n;
+	left -= n;
+    }
+}
+
+// Read what is there from fd into buffer. Returns false on end of file or
+// error.
+static bool receive(int fd, string& buffer) {
+    char data[4096];
+    ssize_t n;
+    do
+	n = recv(fd, data, sizeof data, 0);
+    while (n < 0 && errno == EINTR);
+    if (n <= 0)
+	return false;
+    buffer.append(data, n);
+    return true;
+}
+
+// Take the first complete line out of buffer, if there is one.
+static bool takeLine(string& buffer, string& line) {
+    size_t end = buffer.find('\n');
+    if (end == string::npos)
+	return false;
+    line = buffer.substr(0, end);
+    buffer.erase(0, end + 1);
+    return true;
+}
+
+static void writeMoves(ostream& out, const vector<Move>& moves) {
+    out << moves.size();
+    for (vector<Move>::const_iterator m = moves.begin(); m != moves.end(); ++m)
+	out << ' ' << *m;
+}
+
+static bool readMoves(istream& in, vector<Move>& moves) {
+    size_t length;
+    if (!(in >> length))
+	return false;
+    moves.resize(length);
+    for (size_t i = 0; i < length; ++i)
+	in >> moves[i];
+    return bool(in);
+}
+
+// coordinator
+
+struct Worker {
+    int fd;
+    string buffer;		// received, but not yet a complete line
+    int task;			// index into the frontier, or -1 if idle
+};
+
+static int listenFd = -1;
+static uint64_t myLevelHash;
+static vector<Worker> workers;
+static unsigned nextTaskId;	// ids of earlier iterations are stale
+
+void distributedListen(int port, uint64_t levelHash) {
+    myLevelHash = levelHash;
+    listenFd = socket(AF_INET6, SOCK_STREAM, 0);
+    if (listenFd < 0)
+	throw runtime_error(string("cannot create socket: ")
+			    + strerror(errno));
+    int on = 1, off = 0;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+    // IPv4 too
+    setsockopt(listenFd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof off);
+    struct sockaddr_in6 address;
+    memset(&address, 0, sizeof address);
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_any;
+    address.sin6_port = htons(port);
+    if (bind(listenFd, (struct sockaddr*) &address, sizeof address) != 0
+	|| listen(listenFd, 64) != 0)
+	throw runtime_error(string("cannot listen for workers: ")
+			    + strerror(errno));
+    cout << "Waiting for workers on port " << port << endl;
+}
+
+static void acceptWorker() {
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0)
+	return;
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    ostringstream hello;
+    hello << "level " << hex << myLevelHash;
+    sendLine(fd, hello.str());
+    Worker worker;
+    worker.fd = fd;
+    worker.task = -1;
+    workers.push_back(worker);
+    cout << "Worker connected; " << workers.size() << " in all" << endl;
+}
+
+deque<Move> distributedIDAStar(int maxDist, bool backward,
+			       const SharedBounds* bounds, int* nextMaxDist) {
+    vector<vector<Move> > frontier;
+    int nextMaxMoves;
+    deque<Move> solution = IDAStarFrontier(maxDist, backward, FRONTIER_NODES,
+					   frontier, &nextMaxMoves);
+    if (frontier.empty()) {
+	if (nextMaxDist != NULL)
+	    *nextMaxDist = nextMaxMoves;
+	return solution;
+    }
+    cout << "Distributing " << frontier.size() << " subtrees" << endl;
+    Statistics::timer.start();
+
+    unsigned firstTaskId = nextTaskId;
+    nextTaskId += frontier.size();
+    vector<int> todo;		// stack of frontier indices, next one last
+    for (int i = frontier.size() - 1; i >= 0; --i)
+	todo.push_back(i);
+    size_t numDone = 0;
+    int numBusy = 0;
+    bool cancelled = false, aborted = false;
+    while (cancelled ? numBusy > 0 : numDone < frontier.size()) {
+	if (!cancelled && bounds != NULL && bounds->solved()) {
+	    cancelled = aborted = true;
+	    for (size_t w = 0; w < workers.size(); ++w)
+		if (workers[w].task != -1)
+		    sendLine(workers[w].fd, "cancel");
+	}
+	for (size_t w = 0; w < workers.size() && !cancelled && !todo.empty();
+	     ++w) {
+	    if (workers[w].task != -1)
+		continue;
+	    workers[w].task = todo.back();
+	    todo.pop_back();
+	    ++numBusy;
+	    ostringstream command;
+	    command << "search " << Problem::goalNr << ' ' << maxDist << ' '
+		    << (backward ? "backward" : "forward") << ' '
+		    << firstTaskId + workers[w].task << ' ';
+	    writeMoves(command, frontier[workers[w].task]);
+	    sendLine(workers[w].fd, command.str());
+	}
+
+	// workers first, so that their indices stay valid when one goes
+	vector<struct pollfd> fds(workers.size() + 1);
+	for (size_t w = 0; w < workers.size(); ++w) {
+	    fds[w].fd = workers[w].fd;
+	    fds[w].events = POLLIN;
+	}
+	struct pollfd& listenPoll = fds.back();
+	listenPoll.fd = listenFd;
+	listenPoll.events = POLLIN;
+	if (poll(&fds[0], fds.size(), POLL_INTERVAL) <= 0)
+	    continue;
+
+	for (size_t w = workers.size(); w-- > 0; ) {
+	    Worker& worker = workers[w];
+	    if (fds[w].revents == 0)
+		continue;
+	    if (!receive(worker.fd, worker.buffer)) {
+		cerr << "Lost a worker; " << workers.size() - 1 << " left"
+		     << endl;
+		close(worker.fd);
+		if (worker.task != -1) {
+		    --numBusy;
+		    if (!cancelled)
+			todo.push_back(worker.task);
+		}
+		workers.erase(workers.begin() + w);
+		continue;
+	    }
+	    string line;
+	    while (takeLine(worker.buffer, line)) {
+		istringstream in(line);
+		string tag;
+		unsigned id;
+		int next;
+		uint64_t generated, expanded;
+		vector<Move> moves;
+		if (!(in >> tag >> id >> next >> generated >> expanded)
+		    || tag != "done" || !readMoves(in, moves)) {
+		    cerr << "Warning: bad reply from worker: " << line << endl;
+		    continue;
+		}
+		if (worker.task == -1
+		    || id != firstTaskId + worker.task)
+		    continue;	// stale
+		worker.task = -1;
+		--numBusy;
+		++numDone;
+		Statistics::statesGenerated += generated;
+		Statistics::statesExpanded += expanded;
+		if (next < nextMaxMoves)
+		    nextMaxMoves = next;
+		if (!moves.empty() && !cancelled) {
+		    solution.assign(moves.begin(), moves.end());
+		    cancelled = true;
+		    for (size_t v = 0; v < workers.size(); ++v)
+			if (workers[v].task != -1)
+			    sendLine(workers[v].fd, "cancel");
+		}
+	    }
+	}
+	if (listenPoll.revents != 0)
+	    acceptWorker();
+    }
+
+    Statistics::timer.stop();
+    if (aborted)
+	nextMaxMoves = maxDist;
+    if (nextMaxDist != NULL)
+	*nextMaxDist = nextMaxMoves;
+    return solution;
+}
+
+// worker
+
+static int coordinatorFd;
+static string coordinatorBuffer;
+static SharedBounds* cancelBounds;	// solved() once the task is cancelled
+static int wakeFds[2];		// a pipe to stop the watcher
+
+// Read a line from the coordinator. Returns false if it went away.
+static bool readLine(string& line) {
+    while (!takeLine(coordinatorBuffer, line))
+	if (!receive(coordinatorFd, coordinatorBuffer))
+	    return false;
+    return true;
+}
+
+// Runs while a subtree is searched, and cancels it when the coordinator
+// says so or goes away, until something is written to wakeFds.
+static void* watch(void*) {
+    bool cancelled = false;
+    for (;;) {
+	struct pollfd fds[2];
+	fds[0].fd = wakeFds[0];
+	fds[0].events = POLLIN;
+	fds[1].fd = coordinatorFd;
+	fds[1].events = POLLIN;
+	if (poll(fds, cancelled ? 1 : 2, -1) <= 0)
+	    continue;
+	if (fds[0].revents != 0) {
+	    char c;
+	    if (read(wakeFds[0], &c, 1) == 1)
+		return NULL;
+	}
+	string line;
+	if (!cancelled && fds[1].revents != 0
+	    && (!readLine(line) || line == "cancel")) {
+	    cancelBounds->upperBound = 0;
+	    cancelled = true;
+	}
+    }
+}
+
+static int connectTo(const string& address) {
+    size_t colon = address.rfind(':');
+    if (colon == string::npos)
+	throw runtime_error("coordinator address must be host:port");
+    string host = address.substr(0, colon), port = address.substr(colon + 1);
+    if (host.size() >= 2 && host[0] == '[' && host[host.size() - 1] == ']')
+	host = host.substr(1, host.size() - 2);
+    struct addrinfo hints, *result;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int error = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (error != 0)
+	throw runtime_error("cannot resolve " + address + ": "
+			    + gai_strerror(error));
+    int fd = -1;
+    for (int attempt = 0; fd < 0 && attempt < CONNECT_TIMEOUT; ++attempt) {
+	if (attempt > 0)
+	    sleep(1);
+	for (struct addrinfo* a = result; a != NULL && fd < 0;
+	     a = a->ai_next) {
+	    fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+	    if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+		close(fd);
+		fd = -1;
+	    }
+	}
+    }
+    freeaddrinfo(result);
+    if (fd < 0)
+	throw runtime_error("cannot connect to coordinator " + address);
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    return fd;
+}
+
+void distributedWorker(const Level& level, const string& address) {
+    coordinatorFd = connectTo(address);
+    string line, tag;
+    uint64_t levelHash;
+    if (!readLine(line) || !(istringstream(line) >> tag >> hex >> levelHash)
+	|| tag != "level")
+	throw runtime_error("no greeting from coordinator " + address);
+    if (levelHash != level.hash())
+	throw runtime_error("coordinator " + address
+			    + " is solving a different level");
+    cout << "Connected to coordinator " << address << endl;
+    cancelBounds = SharedBounds::create(0, INT_MAX);
+    IDAStarSetBounds(cancelBounds);
+    if (pipe(wakeFds) != 0)
+	throw runtime_error("cannot create pipe");
+
+    int goalNr = -1, numTasks = 0;
+    while (readLine(line)) {
+	istringstream in(line);
+	int newGoalNr, maxDist;
+	string direction;
+	unsigned id;
+	vector<Move> prefix;
+	if (!(in >> tag) || tag == "cancel")
+	    continue;		// came after the search was done
+	if (tag != "search" || !(in >> newGoalNr >> maxDist >> direction >> id)
+	    || !readMoves(in, prefix)
+	    || newGoalNr < 0 || newGoalNr >= level.numGoals()) {
+	    cerr << "Warning: bad command from coordinator: " << line << endl;
+	    continue;
+	}
+	if (newGoalNr != goalNr) {
+	    goalNr = newGoalNr;
+	    Problem::setGoal(level, goalNr);
+	}
+
+	uint64_t generated = Statistics::statesGenerated;
+	uint64_t expanded = Statistics::statesExpanded;
+	cancelBounds->upperBound = INT_MAX;
+	pthread_t watcher;
+	if (pthread_create(&watcher, NULL, watch, NULL) != 0)
+	    throw runtime_error("cannot create thread");
+	int nextMaxDist;
+	deque<Move> solution = IDAStarSubtree(maxDist, direction == "backward",
+					      prefix, &nextMaxDist);
+	if (write(wakeFds[1], "", 1) != 1)
+	    throw runtime_error("cannot stop watcher");
+	pthread_join(watcher, NULL);
+	++numTasks;
+
+	ostringstream reply;
+	reply << "done " << id << ' ' << nextMaxDist << ' '
+	      << Statistics::statesGenerated - generated << ' '
+	      << Statistics::statesExpanded - expanded << ' ';
+	writeMoves(reply, vector<Move>(solution.begin(), solution.end()));
+	sendLine(coordinatorFd, reply.str());
+    }
+    close(coordinatorFd);
+    cout << "Coordinator is done after " << numTasks << " subtrees" << endl;
+}
@@ -0,0 +1,65 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+
+#ifndef DISTRIBUTED_HH
+#define DISTRIBUTED_HH
+
+#include "stdint.h"
+
+#include <deque>
+#include <string>
+
+#include "Move.hh"
+
+class Level;
+struct SharedBounds;
+
+// IDA* spread over worker processes, possibly on other machines. For each
+// iteration, the coordinator expands the root breadth-first to a frontier of
+// about FRONTIER_NODES nodes, and hands their subtrees out to the workers
+// one at a time over TCP, in the order they were generated. A worker
+// searches each subtree with IDAStarSubtree() and reports back the
+// solution, if any, the smallest f-value it cut off and its statistics. The
+// first solution cancels the subtrees still running. The subtree of a
+// worker that goes away is handed to the next one.
+//
+// The protocol is line-based text:
+//   coordinator: level <hash>          once, after the worker connected
+//   coordinator: search <goal> <bound> forward|backward <id> <n> <moves>
+//   coordinator: cancel                stop the running search
+//   worker:      done <id> <next bound> <generated> <expanded> <n> <moves>
+
+// Accept workers on port; they must have loaded the level with levelHash.
+void distributedListen(int port, uint64_t levelHash);
+
+// Search like IDAStar() for the current goal of Problem, with the workers.
+// Blocks until at least one worker is connected. Stops when bounds are
+// solved.
+std::deque<Move> distributedIDAStar(int maxDist, bool backward,
+				    const SharedBounds* bounds,
+				    int* nextMaxDist = NULL);
+
+// Connect to the coordinator at address, which is host:port, and search
+// subtrees of level for it until it goes away.
+void distributedWorker(const Level& level, const std::string& address);
+
+#endif
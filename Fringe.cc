@@ -0,0 +1,219 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+
+#include "stdint.h"
+#include <limits.h>
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include "AStarState.hh"
+#include "Fringe.hh"
+#include "HashTable.hh"
+#include "IDAStar.hh"
+#include "LargeMemory.hh"
+#include "Problem.hh"
+#include "State.hh"
+#include "Statistics.hh"
+#include "parameters.hh"
+
+#define DEBUG0(x) do { } while (0)
+#define DEBUG1(x) cout << x << endl
+
+using namespace std;
+
+static const double LOAD_FACTOR = 1.4;
+
+// A state on the frontier, with the number of moves it had when it was put
+// there. If a shorter path to it turns up later, it is put there again, and
+// this entry becomes stale.
+struct FringeEntry {
+    uint64_t nr;		// in the state table
+    uint32_t numMoves;
+    FringeEntry(uint64_t nnr, uint32_t nnumMoves)
+	: nr(nnr), numMoves(nnumMoves) { }
+};
+
+// The frontiers of all goals together may use half the memory; the other
+// half is left for IDAStar() when a goal falls back to it.
+static size_t maxStates() {
+    return size_t(LargeMemory::budget() / 2
+		  / (HashTable<AStarState>::BYTES_PER_SLOT * LOAD_FACTOR
+		     + sizeof(AStarState) + sizeof(FringeEntry)));
+}
+
+struct Fringe {
+    Fringe() : states("fringe states") { }
+
+    HashTable<AStarState> states; // numbered from 1, the start is 1
+    vector<FringeEntry> later;	  // to be searched with the next threshold
+    int threshold;		  // smallest f-value in later
+};
+
+static vector<Fringe*> fringes;	// by goal number; NULL if none yet
+static vector<bool> tooLarge;	// goals that are searched with IDA*
+static size_t totalStates;	// in all fringes
+static vector<FringeEntry> now;	// to be searched with this threshold
+
+static void dropFringe(int goalNr) {
+    totalStates -= fringes[goalNr]->states.size();
+    delete fringes[goalNr];
+    fringes[goalNr] = NULL;
+}
+
+// follow the predecessors from state nr back to the start
+static deque<Move> buildSolution(HashTable<AStarState>& states, uint64_t nr,
+				 const Move& lastMove) {
+    deque<Move> solution;
+    solution.push_front(lastMove);
+    while (nr != 1) {
+	const AStarState& state = states[nr];
+	const AStarState& predecessor = states[state.predecessor];
+	vector<Move> moves = predecessor.moves();
+	for (vector<Move>::const_iterator m = moves.begin();
+	     m != moves.end(); ++m) {
+	    if (AStarState(predecessor, *m) == state) {
+		solution.push_front(*m);
+		break;
+	    }
+	}
+	nr = state.predecessor;
+    }
+    return solution;
+}
+
+deque<Move> fringeSearch(const State& startState, int maxDist,
+			 int* nextMaxDist) {
+    int goalNr = Problem::goalNr;
+    if (goalNr >= int(fringes.size())) {
+	fringes.resize(goalNr + 1);
+	tooLarge.resize(goalNr + 1);
+    }
+    if (tooLarge[goalNr])
+	return IDAStar(maxDist, false, nextMaxDist);
+
+    AStarState start = startState;
+    if (start.minTotalMoves() > maxDist) {
+	if (nextMaxDist != NULL)
+	    *nextMaxDist = start.minTotalMoves();
+	return deque<Move>();	// saves the allocations
+    }
+
+    if (fringes[goalNr] == NULL) {
+	Fringe* fringe = new Fringe;
+	fringe->states.insertNew(start);
+	fringe->later.push_back(FringeEntry(1, 0));
+	fringe->threshold = start.minTotalMoves();
+	fringes[goalNr] = fringe;
+	++totalStates;
+	++Statistics::statesGenerated;
+    }
+    Fringe& fringe = *fringes[goalNr];
+    HashTable<AStarState>& states = fringe.states;
+
+    Statistics::timer.start();
+    while (!fringe.later.empty() && fringe.threshold <= maxDist) {
+	int threshold = fringe.threshold;
+	DEBUG1("Fringe threshold " << threshold << ": "
+	       << fringe.later.size() << " states");
+	// now is used as a stack, so keep the order of the frontier
+	now.assign(fringe.later.rbegin(), fringe.later.rend());
+	fringe.later.clear();
+	fringe.threshold = INT_MAX;
+
+	while (!now.empty()) {
+	    FringeEntry entry = now.back();
+	    now.pop_back();
+	    // the table may grow below, so don't keep a reference
+	    AStarState state = states[entry.nr];
+	    if (state.numMoves != entry.numMoves)
+		continue;	// there is a shorter path to it
+	    if (state.minTotalMoves() > threshold) {
+		fringe.later.push_back(entry);
+		if (state.minTotalMoves() < fringe.threshold)
+		    fringe.threshold = state.minTotalMoves();
+		continue;
+	    }
+
+	    vector<Move> moves = state.moves();
+	    ++Statistics::statesExpanded;
+	    Statistics::numChildren += moves.size();
+	    // push in reverse, so the first child is searched first
+	    for (vector<Move>::const_reverse_iterator m = moves.rbegin();
+		 m != moves.rend(); ++m) {
+		++Statistics::statesGenerated;
+		// % is extremely slow on int64_t...
+		if ((Statistics::statesGenerated & 0xffffff) == 0) {
+		    cout << "\nthreshold: " << threshold
+			 << "\nstates: " << states.size()
+			 << " \t(all goals: " << totalStates
+			 << "/" << maxStates() << ")\n";
+		    Statistics::print(cout);
+		}
+		AStarState newState(state, *m);
+		newState.predecessor = entry.nr;
+		if (newState.minMovesLeft() == 0) {
+		    // special property of our heuristic...
+		    Statistics::timer.stop();
+		    cout << "Found solution.\nstates: " << states.size()
+			 << "\n";
+		    Statistics::print(cout);
+		    deque<Move> solution
+			= buildSolution(states, entry.nr, *m);
+		    now.clear();
+		    dropFringe(goalNr);
+		    return solution;
+		}
+
+		bool isNew;
+		AStarState& oldState = *states.findOrInsert(newState, isNew);
+		if (isNew) {
+		    if (++totalStates > maxStates()) {
+			Statistics::timer.stop();
+			cout << "Fringe search out of memory at "
+			     << states.size() << " states; using IDA* for "
+			     << "this goal from now on.\n";
+			now.clear();
+			dropFringe(goalNr);
+			tooLarge[goalNr] = true;
+			return IDAStar(maxDist, false, nextMaxDist);
+		    }
+		} else if (newState.numMoves < oldState.numMoves) {
+		    oldState.numMoves = newState.numMoves;
+		    oldState.predecessor = newState.predecessor;
+		} else {
+		    continue;	// we already know a path as short
+		}
+		now.push_back(FringeEntry(states.numberOf(oldState),
+					  newState.numMoves));
+	    }
+	}
+    }
+    Statistics::timer.stop();
+
+    // keep the frontier for the next call with this goal
+    if (nextMaxDist != NULL)
+	*nextMaxDist = fringe.later.empty() ? INT_MAX : fringe.threshold;
+    return deque<Move>();
+}
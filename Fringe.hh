@@ -0,0 +1,42 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+
+#ifndef FRINGE_HH
+#define FRINGE_HH
+
+#include <deque>
+
+class State;
+
+#include "Move.hh"
+
+// Fringe search [Bjoernsson et al. 2005]: like IDA*, but the frontier where
+// an iteration stopped is kept, so the next threshold continues from there
+// instead of from the root. The frontier of each goal is kept between calls
+// as long as memory allows; once a goal's states don't fit any more, it is
+// searched with IDAStar() from then on. Returns like aStar2().
+std::deque<Move> fringeSearch(const State& start, int maxDist,
+			      int* nextMaxDist = NULL);
+
+#define ALGORITHM_NAME "fringe"
+
+#endif
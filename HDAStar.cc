@@ -0,0 +1,357 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "CacheState.hh"
+#include "HDAStar.hh"
+#include "HashTable.hh"
+#include "LargeMemory.hh"
+#include "Statistics.hh"
+#include "parameters.hh"
+
+using namespace std;
+
+static const double LOAD_FACTOR = 1.4;
+
+// children for another thread are sent when this many have been collected,
+// or after FLUSH_INTERVAL expansions
+static const size_t BATCH_SIZE = 256;
+static const uint64_t FLUSH_INTERVAL = 1024;
+
+class HDANode : public CacheState {
+public:
+    // leave uninitialized
+    HDANode() { }
+    HDANode(const CacheState& state, int nnumMoves, int nminMovesLeft,
+	    int nparentOwner, uint64_t nparentNr, const Move& nmove)
+	: CacheState(state), move(nmove), parentNr(nparentNr),
+	  parentOwner(nparentOwner), numMoves(nnumMoves),
+	  minMovesLeft(nminMovesLeft), isOpen(true) { }
+
+    int minTotalMoves() const { return numMoves + minMovesLeft; }
+
+    Move move;			// from the parent, in its atom numbering
+    uint64_t parentNr;		// in the table of parentOwner; 0 for start
+    uint16_t parentOwner;
+    uint16_t numMoves;
+    uint16_t minMovesLeft;
+    bool isOpen;
+};
+
+static size_t maxStates() {
+    return size_t(LargeMemory::budget()
+		  / (HashTable<HDANode>::BYTES_PER_SLOT * LOAD_FACTOR
+		     + sizeof(HDANode) + sizeof(uint64_t)));
+}
+
+// a message from one thread to another
+struct Batch {
+    Batch* next;
+    vector<HDANode> nodes;
+};
+
+struct Worker {
+    Worker() : states("HDA* states") { }
+
+    int nr;
+    HashTable<HDANode> states;
+    vector<vector<uint64_t> > open; // open[f]: numbers of states, some stale
+    int minOpen;		// no open states with smaller f
+    Batch* volatile inbox;	// pushed by anyone, taken by this thread
+    vector<Batch*> outbox;	// indexed by receiver
+    uint64_t statesGenerated, statesExpanded;
+};
+
+static vector<Worker*> workers;
+static int maxMoves;
+static volatile int nextMaxMoves;
+static volatile bool finished, tableFull;
+
+// Termination: when a thread sees all threads idle, as many nodes received
+// as sent, and no thread became busy in between, nothing is left to do. A
+// thread leaving the idle state first decrements numIdle, then increments
+// activations, and only then receives its batch. So if the check saw all
+// threads idle, any thread waking after that either still has its batch
+// unreceived, which shows in the counters, or has already incremented
+// activations, which shows in the second look at it.
+static volatile uint64_t nodesSent, nodesReceived;
+static volatile int numIdle;
+static volatile uint64_t activations;
+
+// the best solution so far ends with goalMove from the given state
+static pthread_mutex_t solutionMutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile int solutionLength;
+static int goalOwner;
+static uint64_t goalParentNr;
+static Move goalMove;
+
+static void lowerTo(volatile int& x, int value) {
+    int old;
+    while ((old = x) > value && !__sync_bool_compare_and_swap(&x, old, value))
+	{ }
+}
+
+static int owner(const HDANode& node) {
+    uint64_t hash = node.hash() * 0x9e3779b97f4a7c15ULL;
+    return (uint64_t(uint32_t(hash >> 32)) * workers.size()) >> 32;
+}
+
+// Put node into w's table, or improve the path to the state there.
+static void add(Worker& w, const HDANode& node) {
+    if (w.states.capacityLeft() == 0) {
+	tableFull = finished = true;
+	return;
+    }
+    bool isNew;
+    HDANode& state = *w.states.findOrInsert(node, isNew);
+    if (!isNew) {
+	if (node.numMoves >= state.numMoves)
+	    return;
+	state.numMoves = node.numMoves;
+	state.parentOwner = node.parentOwner;
+	state.parentNr = node.parentNr;
+	state.move = node.move;
+	state.isOpen = true;
+    }
+    int f = state.minTotalMoves();
+    w.open[f].push_back(w.states.numberOf(state));
+    if (f < w.minOpen)
+	w.minOpen = f;
+}
+
+static void flush(Worker& w, int to) {
+    Batch* batch = w.outbox[to];
+    if (batch->nodes.empty())
+	return;
+    __sync_fetch_and_add(&nodesSent, batch->nodes.size());
+    Worker& receiver = *workers[to];
+    Batch* old;
+    do {
+	old = receiver.inbox;
+	batch->next = old;
+    } while (!__sync_bool_compare_and_swap(&receiver.inbox, old, batch));
+    w.outbox[to] = new Batch;
+}
+
+static void flushAll(Worker& w) {
+    for (size_t to = 0; to < workers.size(); ++to)
+	if (int(to) != w.nr)
+	    flush(w, to);
+}
+
+static void receive(Worker& w) {
+    Batch* batch = __sync_lock_test_and_set(&w.inbox, (Batch*) NULL);
+    while (batch != NULL) {
+	for (vector<HDANode>::const_iterator node = batch->nodes.begin();
+	     node != batch->nodes.end(); ++node)
+	    add(w, *node);
+	__sync_fetch_and_add(&nodesReceived, batch->nodes.size());
+	Batch* next = batch->next;
+	delete batch;
+	batch = next;
+    }
+}
+
+// Return the number of an open state with smallest f below the solution
+// length, and close it, or 0 if there is none.
+static uint64_t nextOpen(Worker& w) {
+    for (; w.minOpen <= maxMoves && w.minOpen < solutionLength; ++w.minOpen) {
+	vector<uint64_t>& bucket = w.open[w.minOpen];
+	while (!bucket.empty()) {
+	    uint64_t nr = bucket.back();
+	    bucket.pop_back();
+	    HDANode& state = w.states[nr];
+	    if (state.isOpen && state.minTotalMoves() == w.minOpen) {
+		state.isOpen = false;
+		return nr;
+	    }
+	}
+    }
+    return 0;
+}
+
+static void expand(Worker& w, uint64_t nr) {
+    const HDANode node = w.states[nr]; // the table may move
+    ++w.statesExpanded;
+    vector<Move> moves = node.moves();
+    for (vector<Move>::const_iterator m = moves.begin();
+	 m != moves.end(); ++m) {
+	++w.statesGenerated;
+	CacheState child(node, *m);
+	int numMoves = node.numMoves + 1;
+	int minMovesLeft = child.minMovesLeft();
+	if (minMovesLeft == 0) { // special property of our heuristic...
+	    pthread_mutex_lock(&solutionMutex);
+	    if (numMoves < solutionLength) {
+		solutionLength = numMoves;
+		goalOwner = w.nr;
+		goalParentNr = nr;
+		goalMove = *m;
+	    }
+	    pthread_mutex_unlock(&solutionMutex);
+	    continue;
+	}
+	if (numMoves + minMovesLeft > maxMoves) {
+	    lowerTo(nextMaxMoves, numMoves + minMovesLeft);
+	    continue;
+	}
+	if (numMoves + minMovesLeft >= solutionLength)
+	    continue;
+
+	HDANode childNode(child, numMoves, minMovesLeft, w.nr, nr, *m);
+	int to = owner(childNode);
+	if (to == w.nr) {
+	    add(w, childNode);
+	} else {
+	    w.outbox[to]->nodes.push_back(childNode);
+	    if (w.outbox[to]->nodes.size() >= BATCH_SIZE)
+		flush(w, to);
+	}
+    }
+}
+
+static void* run(void* arg) {
+    Worker& w = *static_cast<Worker*>(arg);
+    while (!finished) {
+	receive(w);
+	uint64_t nr = nextOpen(w);
+	if (nr != 0) {
+	    expand(w, nr);
+	    if (w.statesExpanded % FLUSH_INTERVAL == 0)
+		flushAll(w);
+	    continue;
+	}
+
+	flushAll(w);
+	__sync_fetch_and_add(&numIdle, 1);
+	while (!finished && w.inbox == NULL) {
+	    uint64_t before = activations;
+	    __sync_synchronize();
+	    if (numIdle == int(workers.size()) && nodesSent == nodesReceived) {
+		__sync_synchronize();
+		if (activations == before) {
+		    finished = true;
+		    break;
+		}
+	    }
+	    sched_yield();
+	}
+	// in this order; see above
+	__sync_fetch_and_sub(&numIdle, 1);
+	__sync_fetch_and_add(&activations, 1);
+    }
+    return NULL;
+}
+
+deque<Move> hdaStar(const State& startState, int nmaxMoves, int* nextMaxDist,
+		    int numThreads) {
+    CacheState start(startState);
+    maxMoves = nmaxMoves;
+    if (start.minMovesLeft() > maxMoves) {
+	if (nextMaxDist != NULL)
+	    *nextMaxDist = start.minMovesLeft();
+	return deque<Move>();
+    }
+
+    // each worker probes its own table, but they are all set up here
+    LargeMemory::setInterleaved(numThreads > 1);
+    workers.resize(numThreads);
+    for (int t = 0; t < numThreads; ++t) {
+	Worker* w = new Worker;
+	w->nr = t;
+	w->states.clear(maxStates() / numThreads, LOAD_FACTOR);
+	w->open.resize(maxMoves + 1);
+	w->minOpen = INT_MAX;
+	w->inbox = NULL;
+	for (int to = 0; to < numThreads; ++to)
+	    w->outbox.push_back(new Batch);
+	w->statesGenerated = w->statesExpanded = 0;
+	workers[t] = w;
+    }
+    LargeMemory::setInterleaved(false);
+    nextMaxMoves = INT_MAX;
+    finished = tableFull = false;
+    nodesSent = nodesReceived = 0;
+    numIdle = 0;
+    activations = 0;
+    solutionLength = maxMoves + 1;
+
+    HDANode startNode(start, 0, start.minMovesLeft(), 0, 0, Move());
+    add(*workers[owner(startNode)], startNode);
+    ++Statistics::statesGenerated;
+
+    vector<pthread_t> threads(numThreads);
+    Statistics::timer.start();
+    for (int t = 0; t < numThreads; ++t)
+	if (pthread_create(&threads[t], NULL, run, workers[t]) != 0)
+	    throw runtime_error("cannot create thread");
+    for (int t = 0; t < numThreads; ++t) {
+	pthread_join(threads[t], NULL);
+	Statistics::statesGenerated += workers[t]->statesGenerated;
+	Statistics::statesExpanded += workers[t]->statesExpanded;
+	Statistics::numChildren += workers[t]->statesGenerated;
+    }
+    Statistics::timer.stop();
+    if (tableFull) {
+	cout << "State table full.\n";
+	exit(1);
+    }
+
+    deque<Move> solution;
+    if (solutionLength <= maxMoves) {
+	solution.push_front(goalMove);
+	int nodeOwner = goalOwner;
+	uint64_t nr = goalParentNr;
+	for (;;) {
+	    const HDANode& node = workers[nodeOwner]->states[nr];
+	    if (node.parentNr == 0)
+		break;
+	    solution.push_front(node.move);
+	    nodeOwner = node.parentOwner;
+	    nr = node.parentNr;
+	}
+	solution = uncanonicalMoves(solution);
+    } else if (nextMaxDist != NULL) {
+	*nextMaxDist = nextMaxMoves;
+    }
+
+    for (int t = 0; t < numThreads; ++t) {
+	Worker* w = workers[t];
+	// only left over if the table got full
+	for (Batch* batch = w->inbox; batch != NULL; ) {
+	    Batch* next = batch->next;
+	    delete batch;
+	    batch = next;
+	}
+	for (int to = 0; to < numThreads; ++to)
+	    delete w->outbox[to];
+	delete w;
+    }
+    return solution;
+}
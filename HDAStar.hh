@@ -0,0 +1,40 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#ifndef HDASTAR_HH
+#define HDASTAR_HH
+
+#include <deque>
+
+class State;
+
+#include "Move.hh"
+
+// Hash-distributed A* [Kishimoto et al. 2009] with numThreads threads. Each
+// thread owns the states whose hash selects it, with its own table and open
+// list, so the threads never share a table; children are sent to their
+// owner in batches through lock-free queues. States may be expanded before
+// their best path is known, and are reopened when it turns up. Returns like
+// aStar2().
+std::deque<Move> hdaStar(const State& start, int maxDist, int* nextMaxDist,
+			 int numThreads);
+
+#endif
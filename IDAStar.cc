@@ -20,8 +20,11 @@
 */
 
 #include <assert.h>
+#include <limits.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <deque>
 #include <iostream>
@@ -31,7 +34,10 @@
 #include "HashTable.hh"
 #include "IDAStar.hh"
 #include "IDAStarState.hh"
+#include "LargeMemory.hh"
+#include "MovePruning.hh"
 #include "Problem.hh"
+#include "SharedBounds.hh"
 #include "State.hh"
 #include "Statistics.hh"
 #include "Timer.hh"
@@ -40,8 +46,12 @@
 #ifdef DO_CACHING
 #include "IDAStarCacheState.hh"
 #endif
+#ifdef DO_DISK_CACHING
+#include "DiskCache.hh"
+#endif
 #ifdef DO_PARTIAL
 #include "BitVector.hh"
+#include "BloomFilter.hh"
 #endif
 
 #define DEBUG0(x) do { } while (0)
@@ -50,16 +60,26 @@
 #ifdef DO_CACHING
 static const double LOAD_FACTOR = 1.4;
 
-static const unsigned int MAX_STATES = (unsigned int)
-    (MEMORY / (sizeof(int) * LOAD_FACTOR + sizeof(IDAStarCacheState)));
+static size_t maxStates() {
+    return size_t(LargeMemory::budget()
+		  / (HashTable<IDAStarCacheState>::BYTES_PER_SLOT * LOAD_FACTOR
+		     + sizeof(IDAStarCacheState)));
+}
 
 static int cacheGoalNr = -1;
-static HashTable<IDAStarCacheState> cachedStates;
+static HashTable<IDAStarCacheState> cachedStates("IDA* cache");
+#endif
+#ifdef DO_DISK_CACHING
+static uint64_t diskCacheHits;
 #endif
 #ifdef DO_PARTIAL
+#ifdef DO_BLOCKED_PARTIAL
+static BloomFilter<PARTIAL_PROBES> stateBits;
+#else
 static BitVector stateBits;
+#endif
 static uint64_t numBitsSet;
-static const uint64_t maxBitsSet = (MEMORY * 8) / 16;
+static uint64_t maxBitsSet;
 static bool doAddBits;
 #endif
 #ifdef DO_COMPACTION
@@ -70,40 +90,404 @@ static size_t compactionTableEntries;
 
 // global variables to describe current search state
 static int maxMoves;
+static int nextMaxMoves;	// smallest f-value above maxMoves seen
 static IDAStarState state;
 #ifdef DO_MAY_MOVE_PRUNING
 bool mayMove[NUM_ATOMS][4];
 #endif
+static bool searchBackward;
 static deque<Move> solution;
+// IDA*_CR: solutions longer than this may not be optimal, so the search
+// goes on looking for shorter ones
+static int provenBound = INT_MAX;
+static deque<Move> bestSolution;	// shortest one so far
+// cutoffs[f] is how many nodes with f-value f were cut off
+static vector<uint64_t> cutoffs;
+// nodes at most this many moves below the bound are searched by
+// lookahead(), without table probes
+static int lookaheadDepth = LOOKAHEAD;
 static Timer timer;
+static vector<Move> path;	// path[i] is the move done at depth i
 
-static bool dfs(const Move& lastMove);
+#ifdef DO_MOVE_ORDERING
+// History heuristic [Reinefeld & Marsland 1994]: how often a move led
+// toward the smallest f-value cut off below a node, weighted by the depth of
+// the subtree, or was on a solution. Halved before each search, so it
+// follows the current goal.
+static uint32_t history[NUM_ATOMS][NUM_FIELDS][4];
+// the smallest f-value cut off below the node at each depth so far, and
+// the move leading toward it
+static vector<int> subtreeMinCutoff;
+static vector<Move> subtreeBestMove;
 
-deque<Move> IDAStar(int maxDist) {
-    DEBUG0("IDAStar" << maxDist);
-    ++Statistics::statesGenerated;
-#ifndef DO_BACKWARD_SEARCH
-    state = State(Problem::startPositions());
-#else
-    state = State(Problem::rstartPositions());
+static inline uint32_t& historyOf(const Move& move) {
+    return history[move.atomNr()][move.pos1().fieldNumber()]
+	[noOfDir(move.dir())];
+}
+
+static inline unsigned char encodeMove(const Move& move) {
+    return 4 * move.atomNr() + noOfDir(move.dir()) + 1;
+}
+
+// how much a good move at depth is worth
+static inline uint32_t historyWeight(int depth) {
+    int height = maxMoves - depth;
+    return height * height;
+}
+
+// Note that the child reached by path[depth] is done.
+static inline void propagateCutoff(int depth) {
+    if (subtreeMinCutoff[depth + 1] < subtreeMinCutoff[depth]) {
+	subtreeMinCutoff[depth] = subtreeMinCutoff[depth + 1];
+	subtreeBestMove[depth] = path[depth];
+    }
+}
+
+// Note that move from depth was cut off with f-value f.
+static inline void noteCutoff(int depth, int f, const Move& move) {
+    if (f < subtreeMinCutoff[depth]) {
+	subtreeMinCutoff[depth] = f;
+	subtreeBestMove[depth] = move;
+    }
+}
+
+static inline uint32_t orderKey(const Move& move, unsigned char hint) {
+    return encodeMove(move) == hint ? UINT32_MAX : historyOf(move);
+}
+
+// Sort moves[0..n) by history, with the move encoded as hint first.
+static void orderMoves(Move* moves, int n, unsigned char hint) {
+    for (int i = 1; i < n; ++i) {
+	Move move = moves[i];
+	uint32_t key = orderKey(move, hint);
+	int j;
+	for (j = i; j > 0 && orderKey(moves[j - 1], hint) < key; --j)
+	    moves[j] = moves[j - 1];
+	moves[j] = move;
+    }
+}
+#endif
+
+// children of the node at depth d go to moveBuffer[3 * d * maxChildren],
+// one block of maxChildren moves for each bucket
+static int maxChildren;
+static vector<Move> moveBuffer;
+
+// A child of the node being expanded that is within the bound, between
+// evaluating it and sorting it into its bucket.
+struct Child {
+    Move move;
+    int minMovesLeft;
+#ifdef DO_COMPACTION
+    size_t slot;		// in compactionTable
+    size_t signature;
+#endif
+};
+static vector<Child> children;	// maxChildren of them
+
+// a node on the path of the depth-first search
+struct Frame {
+    int minMovesLeft;
+    int bucketsize[3];
+    int bucketNr, childNr;	// the child being searched
+#ifdef DO_CACHING
+    IDAStarCacheState cacheState;
+#endif
+#ifdef DO_MAY_MOVE_PRUNING
+    bool mayMoveBak[NUM_ATOMS][4];
+#endif
+};
+static vector<Frame> frames;	// frames[d] is the node at depth d
+
+enum { CUT_OFF, EXPANDED, SOLVED };
+
+// checkpointing
+static IDAStarCheckpointHandler checkpointHandler;
+static int checkpointInterval;
+static time_t nextCheckpointTime;
+static volatile sig_atomic_t searching, stopRequested, checkpointRequested;
+static vector<Move> resumePath;	// continue the search from here
+static bool resumeFailed;
+
+static const SharedBounds* sharedBounds;
+static bool aborted;		// because sharedBounds were solved
+
+template<bool BACKWARD> static bool dfs();
+
+static bool search() {
+    return searchBackward ? dfs<true>() : dfs<false>();
+}
+
+void IDAStarSetBounds(const SharedBounds* bounds) {
+    sharedBounds = bounds;
+}
+
+void IDAStarSetProvenBound(int bound) {
+    provenBound = bound;
+}
+
+void IDAStarSetLookahead(int depth) {
+    lookaheadDepth = depth;
+}
+
+const vector<uint64_t>& IDAStarCutoffs() {
+    return cutoffs;
+}
+
+static inline void countCutoff(int f) {
+    if (f < int(cutoffs.size()))
+	++cutoffs[f];
+}
+
+void IDAStarSetCheckpointHandler(IDAStarCheckpointHandler handler,
+				 int interval) {
+    checkpointHandler = handler;
+    checkpointInterval = interval;
+}
+
+bool IDAStarStop() {
+    if (!searching)
+	return false;
+    stopRequested = 1;
+    checkpointRequested = 1;
+    return true;
+}
+
+// Report where the search is, and stop if that was requested.
+static void checkpoint() {
+    checkpointRequested = 0;
+    // resuming from here would not know about the solution, so the last
+    // checkpoint, which still leads to it, is better
+    if (checkpointHandler != NULL && bestSolution.empty()) {
+	IDAStarCheckpoint position;
+	position.maxMoves = maxMoves;
+	position.backward = searchBackward;
+	position.nextMaxMoves = nextMaxMoves;
+	position.path.assign(path.begin(), path.begin() + state.moves());
+	checkpointHandler(position);
+	nextCheckpointTime = time(NULL) + checkpointInterval;
+    }
+    if (stopRequested) {
+	Statistics::timer.stop();
+	exit(1);
+    }
+}
+
+ostream& operator<<(ostream& out, const IDAStarCheckpoint& position) {
+    out << "bound " << position.maxMoves << '\n'
+	<< "direction " << (position.backward ? "backward" : "forward") << '\n'
+	<< "next " << position.nextMaxMoves << '\n'
+	<< "path " << position.path.size();
+    for (vector<Move>::const_iterator m = position.path.begin();
+	 m != position.path.end(); ++m)
+	out << ' ' << *m;
+    return out << '\n';
+}
+
+istream& operator>>(istream& in, IDAStarCheckpoint& position) {
+    string bound, direction, next, pathTag, directionName;
+    size_t length;
+    if (!(in >> bound >> position.maxMoves >> direction >> directionName
+	  >> next >> position.nextMaxMoves >> pathTag >> length))
+	return in;
+    if (bound != "bound" || direction != "direction" || next != "next"
+	|| pathTag != "path"
+	|| (directionName != "forward" && directionName != "backward")) {
+	in.setstate(ios::failbit);
+	return in;
+    }
+    position.backward = directionName == "backward";
+    position.path.resize(length);
+    for (size_t i = 0; i < length; ++i)
+	in >> position.path[i];
+    return in;
+}
+
+// The maximum number of moves from any state. A reverse move can end on any
+// free field in a straight line, so this depends on the board.
+static int maxNumChildren(bool backward) {
+    if (!backward)
+	return NUM_ATOMS * 4;
+
+    int maxFields = 0;
+    for (Pos pos = 0; pos != Pos::end(); ++pos) {
+	if (Problem::isBlock(pos))
+	    continue;
+	int numFields = 0;
+	for (int dirNo = 0; dirNo < 4; ++dirNo)
+	    for (Pos p = pos + DIRS[dirNo]; !Problem::isBlock(p);
+		 p += DIRS[dirNo])
+		++numFields;
+	if (numFields > maxFields)
+	    maxFields = numFields;
+    }
+    return NUM_ATOMS * maxFields;
+}
+
+// Turn a solution found by backward search, which leads from the goal to the
+// start with reverse moves, into normal moves from the start to the goal.
+// Identical atoms might have been swapped, so they are renumbered by
+// position.
+static deque<Move> forwardSolution(const deque<Move>& rsolution) {
+    deque<Move> moves;
+    Pos positions[NUM_ATOMS];
+    for (int i = 0; i < NUM_ATOMS; ++i)
+	positions[i] = Problem::startPosition(i);
+
+    for (deque<Move>::const_reverse_iterator m = rsolution.rbegin();
+	 m != rsolution.rend(); ++m) {
+	int atomNr = 0;
+	while (positions[atomNr] != m->pos2())
+	    ++atomNr;
+	positions[atomNr] = m->pos1();
+	moves.push_back(Move(atomNr, m->pos2(), m->pos1(), Dir(-m->dir())));
+    }
+
+    return moves;
+}
+
+// Estimate the branching factor of the search from start by looking at all
+// states up to two moves away.
+static double branchingFactor(const State& start, bool backward) {
+    vector<State> layer(1, start);
+    uint64_t numStates = 0, numChildren = 0;
+    for (int depth = 0; depth < 2; ++depth) {
+	vector<State> nextLayer;
+	for (vector<State>::const_iterator s = layer.begin();
+	     s != layer.end(); ++s) {
+	    vector<Move> moves = backward ? s->rmoves() : s->moves();
+	    ++numStates;
+	    numChildren += moves.size();
+	    if (depth == 0)
+		for (vector<Move>::const_iterator m = moves.begin();
+		     m != moves.end(); ++m)
+		    nextLayer.push_back(State(*s, *m));
+	}
+	layer.swap(nextLayer);
+    }
+
+    return double(numChildren) / double(numStates);
+}
+
+bool IDAStarPreferBackward() {
+    double forward = branchingFactor(State(Problem::startPositions()), false);
+    double backward = branchingFactor(State(Problem::rstartPositions()), true);
+    cout << "Branching factor forward: " << forward
+	 << ", backward: " << backward << endl;
+
+    return backward < forward;
+}
+
+static const char* const NAME = "idastar"
+#ifndef DO_PREHEATING
+  "-nopreheat"
+#endif
+#ifndef DO_MOVE_PRUNING
+  "-nomoveprune"
+#endif
+#ifdef DO_MAY_MOVE_PRUNING
+  "-maymoveprune"
+#endif
+#ifdef DO_MOVE_ORDERING
+  "-ordering"
+#endif
+#if !defined(DO_CACHING) && !defined(DO_PARTIAL) && !defined(DO_COMPACTION)
+  "-nocaching"
 #endif
+#ifdef DO_PARTIAL
+  "-partial"
+#endif
+#ifdef DO_BLOCKED_PARTIAL
+  "-blocked"
+#endif
+#ifdef DO_COMPACTION
+  "-compaction"
+#endif
+#ifdef DO_DISK_CACHING
+  "-disk"
+#endif
+#ifdef DO_STOCHASTIC_CACHING
+  "-stochastic"
+#endif
+;
+
+const char* IDAStarName() {
+    return NAME;
+}
+
+// Reset everything that only applies to one iteration.
+static void startIteration() {
+    if (!searchBackward)
+	state = IDAStarState(State(Problem::startPositions()), false);
+    else
+	state = IDAStarState(State(Problem::rstartPositions()), true);
     solution.clear();
-    if (state.minMovesLeft() > maxDist)
-	return solution;	// saves memory allocation and freeing
+    bestSolution.clear();
+    cutoffs.assign(maxMoves + CUTOFF_RANGE + 1, 0);
+
+#ifdef DO_PARTIAL
+    stateBits.init(LargeMemory::budget() * 8);
+    maxBitsSet = stateBits.numBits() / 16;
+    numBitsSet = 0;
+    doAddBits = true;
+#endif
+
+#ifdef DO_COMPACTION
+    LargeMemory::release(compactionTable, compactionTableCapacity,
+			 "compaction table");
+    compactionTableCapacity = LargeMemory::budget();
+    compactionTableEntries = 0;
+    compactionTable = static_cast<uint8_t*>(
+	LargeMemory::allocate(compactionTableCapacity, "compaction table"));
+#endif
+
+    nextMaxMoves = INT_MAX;
+
+#ifdef DO_MAY_MOVE_PRUNING
+    for (int i = 0; i < NUM_ATOMS; ++i)
+	for (int j = 0; j < 4; ++j)
+	    mayMove[i][j] = true;
+#endif
+}
+
+// Size everything for a search with bound maxDist from state, and prepare
+// the cache for it.
+static void setUp(int maxDist) {
+#ifdef DO_MOVE_PRUNING
+    MovePruning::learn(state, searchBackward);
+#endif
+    path.resize(maxDist + 1);
+    frames.resize(maxDist + 1);
+#ifdef DO_MOVE_ORDERING
+    subtreeMinCutoff.resize(maxDist + 2);
+    subtreeBestMove.resize(maxDist + 1);
+    for (int atomNr = 0; atomNr < NUM_ATOMS; ++atomNr)
+	for (int field = 0; field < NUM_FIELDS; ++field)
+	    for (int dirNo = 0; dirNo < 4; ++dirNo)
+		history[atomNr][field][dirNo] /= 2;
+#endif
+    maxChildren = maxNumChildren(searchBackward);
+    children.resize(maxChildren);
+    moveBuffer.resize((maxDist + 1) * 3 * maxChildren);
 
 #ifdef DO_CACHING
     if (Problem::goalNr != cacheGoalNr) {
 	DEBUG1("cache of wrong goal nr. Clearing.");
 	cacheGoalNr = Problem::goalNr;
-	DEBUG1("MAX_STATES = " << MAX_STATES);
-	cachedStates.clear(MAX_STATES, LOAD_FACTOR);
+	DEBUG1("max states = " << maxStates());
+	cachedStates.clear(maxStates(), LOAD_FACTOR);
+#ifdef DO_DISK_CACHING
+	if (DiskCache::isOpen())
+	    DiskCache::clear();
+	else
+	    DiskCache::open(DISK_CACHE_FILE, DISK_CACHE_SIZE);
+#endif
 #ifdef DO_PREHEATING
 	if (maxDist > 0) {
 	    DEBUG1("Pre-heating cache.");
 	    for (maxMoves = 0; maxMoves < maxDist - 3; ++maxMoves) {
 		DEBUG1("Pre-heating with maxDist = " << maxMoves);
-		//dfs(Move(), state, state.minMovesLeft());
-		dfs(Move());
+		search();
 		assert(solution.empty());
 		for (HashTable<IDAStarCacheState>::Iterator it = cachedStates.begin();
 		    it != cachedStates.end(); ++it)
@@ -118,79 +502,555 @@ deque<Move> IDAStar(int maxDist) {
 	    ++((*it).minMovesFromStart); // to force re-expansion
     }
 #endif
+}
 
-#ifdef DO_PARTIAL
-    stateBits.init(MEMORY * 8);
-    numBitsSet = 0;
-    doAddBits = true;
+deque<Move> IDAStar(int maxDist, bool backward, int* nextMaxDist,
+		    const IDAStarCheckpoint* resume) {
+    DEBUG0("IDAStar" << maxDist);
+    if (stopRequested)		// arrived after the last search was done
+	exit(1);
+#ifdef DO_MOVE_ORDERING
+    if (resume != NULL) {
+	// the children are not searched in the same order as before
+	cout << "Cannot resume with move ordering; starting over\n";
+	resume = NULL;
+    }
 #endif
+    ++Statistics::statesGenerated;
+    searchBackward = backward;
+    if (!backward)
+	state = IDAStarState(State(Problem::startPositions()), false);
+    else
+	state = IDAStarState(State(Problem::rstartPositions()), true);
+    solution.clear();
+    if (state.minMovesLeft() > maxDist) {
+	cutoffs.assign(maxDist + CUTOFF_RANGE + 1, 0);
+	countCutoff(state.minMovesLeft());
+	if (nextMaxDist != NULL)
+	    *nextMaxDist = state.minMovesLeft();
+	return solution;	// saves memory allocation and freeing
+    }
 
-#ifdef DO_COMPACTION
-    delete[] compactionTable;
-    compactionTableCapacity = MEMORY;
-    compactionTableEntries = 0;
-    compactionTable = new uint8_t[compactionTableCapacity];
-#ifdef MY_OS_ZEROES_LARGE_MEMORY_ALLOCATIONS
-    if (compactionTableCapacity < 65536)
+    setUp(maxDist);
+
+    maxMoves = maxDist;
+    resumePath.clear();
+    if (resume != NULL) {
+	assert(resume->maxMoves == maxDist && resume->backward == backward);
+	cout << "Resuming at depth " << resume->path.size() << endl;
+	resumePath = resume->path;
+    }
+    resumeFailed = false;
+    aborted = false;
+    startIteration();
+
+    nextCheckpointTime = time(NULL) + checkpointInterval;
+    searching = 1;
+    Statistics::timer.start();
+    search();
+    if (resumeFailed) {
+	cerr << "Warning: checkpoint does not match the search; "
+	     << "starting over\n";
+	startIteration();
+	search();
+    }
+    Statistics::timer.stop();
+    searching = 0;
+    if (resume != NULL && !resumeFailed)
+	nextMaxMoves = min(nextMaxMoves, resume->nextMaxMoves);
+    if (aborted)
+	nextMaxMoves = maxMoves;
+    else if (solution.empty())
+	solution = bestSolution;
+
+    if (backward)
+	solution = forwardSolution(solution);
+    if (nextMaxDist != NULL)
+	*nextMaxDist = nextMaxMoves;
+
+    return solution;
+}
+
+// Breadth-first expansion for IDAStarFrontier(), starting from the state of
+// the search. Returns true and sets rsolution if a solution turns up.
+template<bool BACKWARD>
+static bool cutFrontier(int maxDist, size_t minNodes,
+			vector<vector<Move> >& frontier,
+			deque<Move>& rsolution) {
+    State root(BACKWARD ? Problem::rstartPositions()
+	       : Problem::startPositions());
+    frontier.assign(1, vector<Move>());
+    for (int depth = 0; depth < maxDist && !frontier.empty()
+	     && frontier.size() < minNodes; ++depth) {
+	vector<vector<Move> > next;
+	for (size_t i = 0; i < frontier.size(); ++i) {
+	    const vector<Move>& prefix = frontier[i];
+	    State s = root;
+	    for (int d = 0; d < depth; ++d)
+		s = State(s, prefix[d]);
+	    ++Statistics::statesExpanded;
+	    vector<Move> moves = BACKWARD ? s.rmoves() : s.moves();
+	    for (vector<Move>::const_iterator m = moves.begin();
+		 m != moves.end(); ++m) {
+#ifdef DO_MOVE_PRUNING
+		if (depth > 0
+		    && MovePruning::isPruned<BACKWARD>(&prefix[0], depth, *m))
+		    continue;
 #endif
-	memset(compactionTable, 0, compactionTableCapacity);
+		++Statistics::statesGenerated;
+		State child(s, *m);
+		int minMovesLeft
+		    = BACKWARD ? child.rminMovesLeft() : child.minMovesLeft();
+		if (minMovesLeft == 0) {
+		    rsolution.assign(prefix.begin(), prefix.end());
+		    rsolution.push_back(*m);
+		    return true;
+		}
+		int minTotalMoves = depth + 1 + minMovesLeft;
+		if (minTotalMoves > maxDist) {
+		    countCutoff(minTotalMoves);
+		    if (minTotalMoves < nextMaxMoves)
+			nextMaxMoves = minTotalMoves;
+		    continue;
+		}
+		next.push_back(prefix);
+		next.back().push_back(*m);
+	    }
+	}
+	frontier.swap(next);
+    }
+    return false;
+}
 
+deque<Move> IDAStarFrontier(int maxDist, bool backward, size_t minNodes,
+			    vector<vector<Move> >& frontier,
+			    int* nextMaxDist) {
+    ++Statistics::statesGenerated;
+    searchBackward = backward;
+    if (!backward)
+	state = IDAStarState(State(Problem::startPositions()), false);
+    else
+	state = IDAStarState(State(Problem::rstartPositions()), true);
+    cutoffs.assign(maxDist + CUTOFF_RANGE + 1, 0);
+    nextMaxMoves = INT_MAX;
+    frontier.clear();
+    deque<Move> rsolution;
+    if (state.minMovesLeft() > maxDist) {
+	countCutoff(state.minMovesLeft());
+	nextMaxMoves = state.minMovesLeft();
+    } else {
+#ifdef DO_MOVE_PRUNING
+	MovePruning::learn(state, backward);
 #endif
+	bool solved = backward
+	    ? cutFrontier<true>(maxDist, minNodes, frontier, rsolution)
+	    : cutFrontier<false>(maxDist, minNodes, frontier, rsolution);
+	if (solved)
+	    frontier.clear();
+    }
+    if (nextMaxDist != NULL)
+	*nextMaxDist = nextMaxMoves;
 
-    maxMoves = maxDist;
+    return backward ? forwardSolution(rsolution) : rsolution;
+}
+
+// what the tables were last set up for by IDAStarSubtree()
+static int subtreeGoalNr = -1, subtreeMaxMoves;
+static bool subtreeBackward;
 
+deque<Move> IDAStarSubtree(int maxDist, bool backward,
+			   const vector<Move>& prefix, int* nextMaxDist) {
+    if (stopRequested)
+	exit(1);
+    searchBackward = backward;
+    if (!backward)
+	state = IDAStarState(State(Problem::startPositions()), false);
+    else
+	state = IDAStarState(State(Problem::rstartPositions()), true);
+    if (Problem::goalNr != subtreeGoalNr || maxDist != subtreeMaxMoves
+	|| backward != subtreeBackward) {
+	// the tables stay valid for all subtrees of one iteration
+	subtreeGoalNr = Problem::goalNr;
+	subtreeMaxMoves = maxDist;
+	subtreeBackward = backward;
+	setUp(maxDist);
+	maxMoves = maxDist;
+	startIteration();
+    }
+    solution.clear();
+    cutoffs.assign(maxDist + CUTOFF_RANGE + 1, 0);
+    nextMaxMoves = INT_MAX;
 #ifdef DO_MAY_MOVE_PRUNING
     for (int i = 0; i < NUM_ATOMS; ++i)
 	for (int j = 0; j < 4; ++j)
 	    mayMove[i][j] = true;
 #endif
+    for (size_t d = 0; d < prefix.size(); ++d) {
+	path[d] = prefix[d];
+	state.apply(prefix[d]);
+    }
+    resumePath.clear();
+    resumeFailed = false;
+    aborted = false;
 
+    searching = 1;
     Statistics::timer.start();
-    dfs(Move());
+    search();
     Statistics::timer.stop();
+    searching = 0;
+    if (aborted)
+	nextMaxMoves = maxMoves;
+    if (!solution.empty()) {
+	solution.insert(solution.begin(), prefix.begin(), prefix.end());
+	if (backward)
+	    solution = forwardSolution(solution);
+    }
+    if (nextMaxDist != NULL)
+	*nextMaxDist = nextMaxMoves;
 
     return solution;
 }
 
+// The state reached by move is a goal. Returns true if the search is done;
+// otherwise, there might be a shorter solution, and the bound is lowered.
+static bool foundSolution(const Move& move) {
+#ifdef DO_MOVE_ORDERING
+    for (int depth = 0; depth < int(state.moves()) - 1; ++depth)
+	historyOf(path[depth]) += historyWeight(depth);
+    historyOf(move) += historyWeight(state.moves() - 1);
+#endif
+    if (state.moves() <= provenBound) {
+	solution.push_front(move);
+	return true;
+    }
+    bestSolution.assign(path.begin(), path.begin() + state.moves() - 1);
+    bestSolution.push_back(move);
+    maxMoves = state.moves() - 1;
+    DEBUG1("Found solution in " << state.moves()
+	   << " moves; looking for a shorter one");
+    return false;
+}
+
 #if 1
 static string spaces(int n) {
     return string(n, ' ');
 }
 #endif
 
-static inline bool between(Pos p1, Pos p2, Dir dir, Pos pm) {
-    switch(dir) {
-    case UP:
-	return p1.x() == pm.x() && p2 <= pm && pm <= p1;
-    case DOWN:
-	return p1.x() == pm.x() && p1 <= pm && pm <= p2;
-    case LEFT:
-	return p2 <= pm && pm <= p1;
-    case RIGHT:
-	return p1 <= pm && pm <= p2;
-    default:
-	abort();
+// Evaluate the child reached by move without making the move, if possible,
+// and start loading its table entry. Returns SOLVED if it is a solution,
+// EXPANDED if it is to be placed, and CUT_OFF otherwise.
+template<bool BACKWARD>
+static inline int evaluateChild(const Move& move, Child& child) {
+    ++Statistics::numChildren;
+    DEBUG0(spaces(state.moves()) << "moves to " << move.pos2());
+#ifdef DO_MOVE_PRUNING
+    if (MovePruning::isPruned<BACKWARD>(&path[0], state.moves(), move)) {
+	++Statistics::numPruned;
+	return CUT_OFF;
+    }
+#endif // #ifdef DO_MOVE_PRUNING
+    ++Statistics::statesGenerated;
+    ++Statistics::statesGeneratedAtDepth[maxMoves];
+
+    int oldMinMovesLeft = state.minMovesLeft();
+    int minMovesLeft;
+    if (move.atomNr() < NUM_UNIQUE) {
+	minMovesLeft = state.uniqueMinMovesLeft(move);
+    } else {
+	state.apply(move);
+	minMovesLeft = state.minMovesLeft();
+	state.undo(move, oldMinMovesLeft);
+    }
+
+    if (minMovesLeft == 0) {
+	// not true for all heuristics, but for this one
+	state.apply(move, 0);
+	if (foundSolution(move))
+	    return SOLVED;
+	state.undo(move, oldMinMovesLeft);
+	return CUT_OFF;
+    }
+    int minTotalMoves = state.moves() + 1 + minMovesLeft;
+    if (minTotalMoves > maxMoves) {
+	countCutoff(minTotalMoves);
+#ifdef DO_MOVE_ORDERING
+	noteCutoff(state.moves(), minTotalMoves, move);
+#endif
+	if (minTotalMoves < nextMaxMoves)
+	    nextMaxMoves = minTotalMoves;
+	return CUT_OFF;
+    }
+
+    child.move = move;
+    child.minMovesLeft = minMovesLeft;
+#ifdef DO_COMPACTION
+    {
+	// The slot for g is the slot for g = 0 plus g, so that the slots for
+	// g - 1 and g + 1 are next to it.
+	uint64_t hash = state.zobrist(move);
+	child.slot = (unsigned __int128) hash * compactionTableCapacity >> 64;
+	child.slot += state.moves() + 1;
+	if (child.slot >= compactionTableCapacity)
+	    child.slot -= compactionTableCapacity;
+	child.signature = hash % 255 + 1;
+	__builtin_prefetch(&compactionTable[child.slot], 1);
+    }
+#endif
+    return EXPANDED;
+}
+
+#ifdef DO_PARTIAL
+// Has the current state been seen? Notes that it has been now.
+static inline bool seenPartial() {
+#ifdef DO_BLOCKED_PARTIAL
+    // the state picks the cache line and g the bits within it, so looking
+    // for g - 1 as well costs no extra miss
+    uint64_t blockHash = state.hash64_1();
+    uint64_t bitHash = state.hash64_2() + state.moves();
+    if (stateBits.contains(blockHash, bitHash)
+	|| stateBits.contains(blockHash, bitHash - 1))
+	return true;
+
+    if (doAddBits) {
+	numBitsSet += stateBits.insert(blockHash, bitHash);
+	if (numBitsSet > maxBitsSet) {
+	    DEBUG1(" Bit hash table full");
+	    doAddBits = false;
+	}
+    }
+#else
+    // ugh... 64 bit modulo is dog slow on i386...
+    uint64_t hash1 = (state.hash64_1() + state.moves())
+		    % stateBits.numBits();
+    uint64_t hash2 = (state.hash64_2() + state.moves())
+		    % stateBits.numBits();
+    DEBUG0(state << " hashes to " << hash1 << " & " << hash2);
+    int bitsSet = stateBits.isSet(hash1) + stateBits.isSet(hash2);
+    if (bitsSet == 2) {
+	DEBUG0(" bits already set");
+	return true;
+    }
+
+    // perhaps it is the table with $g$ less by one?
+    uint64_t hash1a
+	= hash1 == 0 ? stateBits.numBits() - 1 : hash1 - 1;
+    uint64_t hash2a
+	= hash2 == 0 ? stateBits.numBits() - 1 : hash2 - 1;
+    if (stateBits.isSet(hash1a) && stateBits.isSet(hash2a))
+	return true;
+
+    if (doAddBits) {
+	stateBits.set(hash1);
+	stateBits.set(hash2);
+	numBitsSet += 2 - bitsSet;
+	if (numBitsSet > maxBitsSet) {
+	    DEBUG1(" Bit hash table full");
+	    doAddBits = false;
+	}
+    }
+#endif
+    return false;
+}
+#endif
+
+#ifdef DO_COMPACTION
+// Has child been seen? Notes that it has been now.
+static inline bool seenCompaction(const Child& child) {
+    size_t hash = child.slot;
+    size_t signature = child.signature;
+    if (compactionTable[hash] == signature)
+	return true;
+
+    // perhaps it is the table with $g - 1$?
+    size_t hashg = hash == 0
+	? compactionTableCapacity - 1 : hash - 1;
+
+    if (compactionTable[hashg] == signature)
+	return true;
+
+    // assume state is new.
+    if (compactionTable[hash] == 0)
+	++compactionTableEntries;
+    compactionTable[hash] = signature;
+
+    // check if it is already in the table with $g + 1$
+    if (++hash == compactionTableCapacity)
+	hash = 0;
+    if (compactionTable[hash] == signature) {
+	// make space for more valuable entry (or, in one of 255
+	// cases, kill a random state needlessly)
+	compactionTable[hash] = 0;
+	--compactionTableEntries;
     }
-    return false;		// Compaq C++ just doesn't get it...
+    return false;
 }
+#endif
 
-static bool dfs(const Move& lastMove) {
-    DEBUG0(spaces(state.moves()) << "dfs: moves =  "
+// Sort child into its bucket, unless it has been seen already.
+static inline void placeChild(const Child& child,
+			      Move* buckets[3], int bucketsize[3]) {
+    // lookahead() searches it without looking at the tables
+    if (maxMoves - (state.moves() + 1) > lookaheadDepth) {
+#ifdef DO_PARTIAL
+	int oldMinMovesLeft = state.minMovesLeft();
+	state.apply(child.move, child.minMovesLeft);
+	bool seen = seenPartial();
+	state.undo(child.move, oldMinMovesLeft);
+	if (seen)
+	    return;
+#endif
+#ifdef DO_COMPACTION
+	if (seenCompaction(child))
+	    return;
+#endif
+    }
+
+    int bucketNr = child.minMovesLeft - state.minMovesLeft() + 1;
+    if (bucketNr < 0 || bucketNr > 2) {
+	    cerr << "Impossible: old minMovesLeft = " << state.minMovesLeft()
+		 << ", new minMovesLeft = " << child.minMovesLeft << endl;
+	    abort();		
+    }
+    
+    buckets[bucketNr][bucketsize[bucketNr]++] = child.move;
+}
+
+// Try move in lookahead(). Returns true if it leads to a solution.
+template<bool BACKWARD> static bool lookahead();
+template<bool BACKWARD>
+static inline bool lookaheadChild(const Move& move) {
+    ++Statistics::numChildren;
+#ifdef DO_MOVE_PRUNING
+    if (MovePruning::isPruned<BACKWARD>(&path[0], state.moves(), move)) {
+	++Statistics::numPruned;
+	return false;
+    }
+#endif
+    int oldMinMovesLeft = state.minMovesLeft();
+    state.apply(move);
+    ++Statistics::statesGenerated;
+    ++Statistics::statesGeneratedAtDepth[maxMoves];
+    if (state.minMovesLeft() == 0) {
+	if (foundSolution(move))
+	    return true;
+    } else if (state.minTotalMoves() > maxMoves) {
+	countCutoff(state.minTotalMoves());
+#ifdef DO_MOVE_ORDERING
+	noteCutoff(state.moves() - 1, state.minTotalMoves(), move);
+#endif
+	if (state.minTotalMoves() < nextMaxMoves)
+	    nextMaxMoves = state.minTotalMoves();
+    } else {
+	path[state.moves() - 1] = move;
+	if (lookahead<BACKWARD>()) {
+	    solution.push_front(move);
+	    return true;
+	}
+#ifdef DO_MOVE_ORDERING
+	propagateCutoff(state.moves() - 1);
+#endif
+    }
+    state.undo(move, oldMinMovesLeft);
+    return false;
+}
+
+// Search the subtree below the current state, which is close enough to the
+// bound that probing the tables costs more than searching it again: just
+// bounds and move pruning, and no checkpoints.
+template<bool BACKWARD>
+static bool lookahead() {
+    ++Statistics::statesExpanded;
+#ifdef DO_MOVE_ORDERING
+    subtreeMinCutoff[state.moves()] = INT_MAX;
+#endif
+    for (int atomNr = 0; atomNr < NUM_ATOMS; ++atomNr) {
+	Pos startPos = state.atomPosition(atomNr);
+	for (int dirNo = 0; dirNo < 4; ++dirNo) {
+	    Dir dir = DIRS[dirNo];
+	    if (!BACKWARD) {
+		Pos pos;
+		for (pos = startPos + dir; !state.isBlocking(pos); pos += dir) { }
+		Pos newPos = pos - dir;
+		if (newPos != startPos
+		    && lookaheadChild<BACKWARD>(Move(atomNr, startPos, newPos,
+						     dir)))
+		    return true;
+	    } else {
+		if (!state.isBlocking(startPos - dir))
+		    continue;
+		for (Pos newPos = startPos + dir; !state.isBlocking(newPos);
+		     newPos += dir)
+		    if (lookaheadChild<BACKWARD>(Move(atomNr, startPos, newPos,
+						      dir)))
+			return true;
+	    }
+	    // a lowered bound may have cut off the rest
+	    if (state.minTotalMoves() > maxMoves)
+		return false;
+	}
+    }
+    return false;
+}
+
+// Look at the node at the end of the path, and generate its children into
+// frame unless it can be cut off.
+template<bool BACKWARD>
+static int expand(Frame& frame) {
+    DEBUG0(spaces(state.moves()) << "expand: moves =  "
 	   << state.moves() << " state = " << state);
+#ifdef DO_MOVE_ORDERING
+    subtreeMinCutoff[state.moves()] = INT_MAX;
+    unsigned char hint = 0;
+#endif
+    // only after a solution lowered maxMoves
+    if (state.minTotalMoves() > maxMoves)
+	return CUT_OFF;
+    if (maxMoves - state.moves() <= lookaheadDepth)
+	return lookahead<BACKWARD>() ? SOLVED : CUT_OFF;
 
 #ifdef DO_CACHING
-    IDAStarCacheState cacheState(state);
+    IDAStarCacheState& cacheState = frame.cacheState;
+    cacheState = IDAStarCacheState(state);
     IDAStarCacheState* cachedState = cachedStates.find(cacheState);
     if (cachedState != NULL) {
 	DEBUG0("found" << state << " in cache");
 	if (cachedState->minMovesFromStart <= state.moves())
-	    return false;
+	    return CUT_OFF;
 	else if (cachedState->minMovesFromStart > state.moves())
 	    cachedState->minMovesFromStart = state.moves();
 
-	if (state.moves() + cachedState->minMovesLeft > maxMoves)
-	    return false;
+	if (state.moves() + cachedState->minMovesLeft > maxMoves) {
+	    countCutoff(state.moves() + cachedState->minMovesLeft);
+	    if (state.moves() + cachedState->minMovesLeft < nextMaxMoves)
+		nextMaxMoves = state.moves() + cachedState->minMovesLeft;
+	    return CUT_OFF;
+	}
+#ifdef DO_MOVE_ORDERING
+	hint = cachedState->bestMove;
+#endif
     }
+#ifdef DO_DISK_CACHING
+    IDAStarCacheState diskState;
+    if (state.moves() <= DISK_CACHE_MAX_DEPTH) {
+	if (cachedState == NULL
+	    && DiskCache::find(cacheState, maxMoves, diskState)) {
+	    ++diskCacheHits;
+	    if (diskState.minMovesFromStart <= state.moves())
+		return CUT_OFF;
+	    if (state.moves() + diskState.minMovesLeft > maxMoves) {
+		countCutoff(state.moves() + diskState.minMovesLeft);
+		if (state.moves() + diskState.minMovesLeft < nextMaxMoves)
+		    nextMaxMoves = state.moves() + diskState.minMovesLeft;
+		return CUT_OFF;
+	    }
+	    // promote what is known into the RAM tier
+	    if (diskState.minMovesLeft > cacheState.minMovesLeft)
+		cacheState.minMovesLeft = diskState.minMovesLeft;
+	}
+	DiskCache::store(cacheState, maxMoves);
+    }
+#endif
 
     if (cachedStates.capacityLeft() > 0
 #ifdef DO_STOCHASTIC_CACHING
@@ -201,13 +1061,16 @@ static bool dfs(const Move& lastMove) {
 #endif
     
     if ((Statistics::statesExpanded & 0xffffff) == 0) {
-	cout << ALGORITHM_NAME << endl << state << " / " << maxMoves << endl
+	cout << NAME << endl << state << " / " << maxMoves << endl
 #ifdef DO_CACHING
 	     << " cached: " << cachedStates.size() << " ("
 	     << double(cachedStates.size()) * 100.0
 	        / double(cachedStates.capacityLeft() + cachedStates.size())
 	     << "%)"
 #endif
+#ifdef DO_DISK_CACHING
+	     << " disk cache hits: " << diskCacheHits
+#endif
 #ifdef DO_PARTIAL
 	     << " cached: " << numBitsSet
 	     << " (" << (double(numBitsSet) * 100.0) / double(maxBitsSet)
@@ -222,21 +1085,34 @@ static bool dfs(const Move& lastMove) {
 	     << " moves = " << state.moves()
 	     << endl;
 	Statistics::print(cout);
+	if (checkpointHandler != NULL && time(NULL) >= nextCheckpointTime)
+	    checkpointRequested = 1;
     }
+    if (checkpointRequested)
+	checkpoint();
+    if (sharedBounds != NULL && (Statistics::statesExpanded & 0xffff) == 0
+	&& sharedBounds->solved())
+	aborted = true;
+    if (aborted)
+	return CUT_OFF;
 
     // generate all moves...
     ++Statistics::statesExpanded;
 
-#ifndef DO_BACKWARD_SEARCH
-    static const int MAX_BUCKET_SIZE = NUM_ATOMS * 4;
-#else
-    // Hmmm... not easy... we don't want to waste space and reduce
-    // locality... We'll just guess and assert later :)
-    static const int MAX_BUCKET_SIZE = NUM_ATOMS * 8;
-#endif    
-    int bucketsize[3] = { };
-    Move buckets[3][MAX_BUCKET_SIZE];
+    frame.minMovesLeft = state.minMovesLeft();
+    frame.bucketNr = 0;
+    frame.childNr = -1;
+    int* bucketsize = frame.bucketsize;
+    Move* buckets[3];
+    for (int bucketNr = 0; bucketNr < 3; ++bucketNr) {
+	bucketsize[bucketNr] = 0;
+	buckets[bucketNr]
+	    = &moveBuffer[(state.moves() * 3 + bucketNr) * maxChildren];
+    }
 
+    // First evaluate all children, then look them up in the tables, so the
+    // lookups don't wait for each other.
+    int numChildren = 0;
     for (int atomNr = 0; atomNr < NUM_ATOMS; ++atomNr) {
 	Pos startPos = state.atomPosition(atomNr);
 	for (int dirNo = 0; dirNo < 4; ++dirNo) {
@@ -247,262 +1123,262 @@ static bool dfs(const Move& lastMove) {
 		continue;
 #endif
 	    
-	    DEBUG0(spaces(moves) << "moving " << atomNr << " @ " << startPos
-		   << ' ' << dir);
-	    Pos newPos;
-#ifndef DO_BACKWARD_SEARCH
-	    Pos pos;
-	    for (pos = startPos + dir; !state.isBlocking(pos); pos += dir) { }
-	    newPos = pos - dir;
-	    if (newPos == startPos)
-		continue;
-#else
-	    if (!state.isBlocking(startPos - dir))
-		continue;
-	    // Note different indention would be needed here
-	    for (newPos = startPos + dir; !state.isBlocking(newPos);
-		 newPos += dir) {
-#endif
-	    ++Statistics::numChildren;
-	    DEBUG0(spaces(moves) << "moves to " << newPos);
-	    Move move(atomNr, startPos, newPos, dir);
-#ifdef DO_MOVE_PRUNING
-	    if (state.moves() > 0) {
-		if (atomNr == lastMove.atomNr() && dir == -lastMove.dir()) {
-		    ++Statistics::numPruned;
+	    DEBUG0(spaces(state.moves()) << "moving " << atomNr << " @ "
+		   << startPos << ' ' << dir);
+	    if (!BACKWARD) {
+		Pos pos;
+		for (pos = startPos + dir; !state.isBlocking(pos); pos += dir) { }
+		Pos newPos = pos - dir;
+		if (newPos == startPos)
 		    continue;
+		int result = evaluateChild<BACKWARD>(
+		    Move(atomNr, startPos, newPos, dir), children[numChildren]);
+		if (result == SOLVED)
+		    return SOLVED;
+		if (result == EXPANDED)
+		    ++numChildren;
+	    } else {
+		// a reverse move pulls the atom away from a blocking field
+		if (!state.isBlocking(startPos - dir))
+		    continue;
+		for (Pos newPos = startPos + dir; !state.isBlocking(newPos);
+		     newPos += dir) {
+		    int result = evaluateChild<BACKWARD>(
+			Move(atomNr, startPos, newPos, dir),
+			children[numChildren]);
+		    if (result == SOLVED)
+			return SOLVED;
+		    if (result == EXPANDED)
+			++numChildren;
 		}
-		if (atomNr < lastMove.atomNr()) {
-		    // this is only allowed if the two moves are not
-		    // independent.
-#ifndef DO_BACKWARD_SEARCH
-		    if (!(between(lastMove.pos1(), lastMove.pos2(),
-				  lastMove.dir(), newPos)
-			  || newPos + dir == lastMove.pos2()
-			  || between(startPos, newPos, dir, lastMove.pos1())
-			  || startPos == lastMove.pos2() + lastMove.dir())) {
-			++Statistics::numPruned;
-			continue;
-#else // defined(DO_BACKWARD_SEARCH)
-		    if (!(between(lastMove.pos1(), lastMove.pos2(),
-				  lastMove.dir(), newPos)
-			  || startPos - dir == lastMove.pos2()
-			  || between(startPos, newPos, dir, lastMove.pos1())
-			  || startPos == lastMove.pos1() - lastMove.dir())) {
-			++Statistics::numPruned;
-			continue;
-#endif // #ifndef DO_BACKWARD_SEARCH
-		    }
-		}
-	    }
-#endif // #ifdef DO_MOVE_PRUNING
-	    int oldMinMovesLeft = state.minMovesLeft();
-	    int bucketNr;
-	    state.apply(move);
-	    ++Statistics::statesGenerated;
-	    ++Statistics::statesGeneratedAtDepth[maxMoves];
-
-	    if (state.minMovesLeft() == 0) {
-		solution.push_front(move);	    
-		return true; // not true for all heuristics, but for this one
 	    }
-	    if (state.minTotalMoves() > maxMoves)
-		goto skip;
+	}
+    }
+    // by now, the table entries of the first children have arrived
+    for (int i = 0; i < numChildren; ++i)
+	placeChild(children[i], buckets, bucketsize);
 
-#ifdef DO_PARTIAL
-	    {
-		// ugh... 64 bit modulo is dog slow on i386...
-		uint64_t hash1 = (state.hash64_1() + state.moves())
-				% stateBits.numBits();
-		uint64_t hash2 = (state.hash64_2() + state.moves())
-				% stateBits.numBits();
-		DEBUG0(state << " hashes to " << hash1 << " & " << hash2);
-		int bitsSet = stateBits.isSet(hash1) + stateBits.isSet(hash2);
-		if (bitsSet == 2) {
-		    DEBUG0(" bits already set");
-		    goto skip;
-		}
+    for (int bucketNr = 0; bucketNr < 3; ++bucketNr)
+	assert(bucketsize[bucketNr] <= maxChildren);
+#ifdef DO_MOVE_ORDERING
+    for (int bucketNr = 0; bucketNr < 3; ++bucketNr)
+	orderMoves(buckets[bucketNr], bucketsize[bucketNr], hint);
+#endif
 
-		// perhaps it is the table with $g$ less by one?
-		uint64_t hash1a
-		    = hash1 == 0 ? stateBits.numBits() - 1 : hash1 - 1;
-		uint64_t hash2a
-		    = hash2 == 0 ? stateBits.numBits() - 1 : hash2 - 1;
-		if (stateBits.isSet(hash1a) && stateBits.isSet(hash2a))
-		    goto skip;
-
-		if (doAddBits) {
-		    stateBits.set(hash1);
-		    stateBits.set(hash2);
-		    numBitsSet += 2 - bitsSet;
-		    if (numBitsSet > maxBitsSet) {
-			DEBUG1(" Bit hash table full");
-			doAddBits = false;
-		    }
-		}
-	    }
+#ifdef DO_DISK_CACHING
+    // the children will be looked up when they are expanded
+    if (state.moves() < DISK_CACHE_MAX_DEPTH)
+	for (int bucketNr = 0; bucketNr < 3; ++bucketNr)
+	    for (int i = 0; i < bucketsize[bucketNr]; ++i)
+		DiskCache::prefetch(CacheState(state, buckets[bucketNr][i]));
 #endif
-#ifdef DO_COMPACTION
-	    {
-		// hash() works much worse than hash2() ???
-		//size_t hash  = (state.hash() + state.moves())
-		//		% compactionTableCapacity;
-		size_t hash  = (state.hash2() + state.moves())
-				% compactionTableCapacity;
-		size_t signature = state.hash() % 255 + 1;
-		if (compactionTable[hash] == signature)
-		    goto skip;
-
-		// perhaps it is the table with $g - 1$?
-		size_t hashg = hash == 0
-		    ? compactionTableCapacity - 1 : hash - 1;
-		
-		if (compactionTable[hashg] == signature)
-		    goto skip;
-
-		// assume state is new.
-		if (compactionTable[hash] == 0)
-		    ++compactionTableEntries;
-		compactionTable[hash] = signature;
-
-		// check if it is already in the table with $g + 1$
-		if (++hash == compactionTableCapacity)
-		    hash = 0;
-		if (compactionTable[hash] == signature) {
-		    // make space for more valuable entry (or, in one of 255
-		    // cases, kill a random state needlessly)
-		    compactionTable[hash] = 0;
-		    --compactionTableEntries;
-		}
-	    }
+
+    return EXPANDED;
+}
+
+// Called when all children of the node at the end of the path are done.
+static void finish(Frame& frame) {
+#ifdef DO_MOVE_ORDERING
+    int depth = state.moves();
+    bool haveBestMove = subtreeMinCutoff[depth] != INT_MAX;
+    if (haveBestMove)
+	historyOf(subtreeBestMove[depth]) += historyWeight(depth);
+#ifdef DO_CACHING
+    frame.cacheState.bestMove
+	= haveBestMove ? encodeMove(subtreeBestMove[depth]) : 0;
 #endif
-	    bucketNr = state.minMovesLeft() - oldMinMovesLeft + 1;
-	    if (bucketNr < 0 || bucketNr > 2) {
-		    cerr << "Impossible: old minMovesLeft = " << oldMinMovesLeft
-			 << ", new minMovesLeft = " << state.minMovesLeft() << endl;
-		    abort();		
-	    }
-	    
-	    buckets[bucketNr][bucketsize[bucketNr]++] = move;
+#endif
+#ifdef DO_CACHING
+    if (cachedStates.capacityLeft() > 0
+#ifdef DO_STOCHASTIC_CACHING
+	&& double(rand()) / double(RAND_MAX)  <= CACHE_INSERT_PROBABILITY
+#endif
+	) {
+	frame.cacheState.minMovesLeft = (maxMoves + 1) - state.moves();
+	cachedStates.insert(frame.cacheState);
+    }
+#ifdef DO_DISK_CACHING
+    if (state.moves() <= DISK_CACHE_MAX_DEPTH) {
+	frame.cacheState.minMovesLeft = (maxMoves + 1) - state.moves();
+	DiskCache::store(frame.cacheState, maxMoves);
+    }
+#endif
+#else
+    (void) frame;
+#endif
+}
 
-	skip:
-	    state.undo(move, oldMinMovesLeft);
-	}
+static inline const Move& child(const Frame& frame, int depth) {
+    return moveBuffer[(depth * 3 + frame.bucketNr) * maxChildren
+		      + frame.childNr];
+}
+
+// Advance frame to its next child, in order of buckets. Returns false if
+// there is none left.
+static inline bool nextChild(Frame& frame) {
+    while (frame.bucketNr < 3) {
+	if (++frame.childNr < frame.bucketsize[frame.bucketNr])
+	    return true;
+	++frame.bucketNr;
+	frame.childNr = -1;
     }
+    return false;
+}
 
-    for (int bucketNr = 0; bucketNr < 3; ++bucketNr) {
-	assert(bucketsize[bucketNr] < MAX_BUCKET_SIZE);
-	for (int i = 0; i < bucketsize[bucketNr]; ++i) {
-	    int oldMinMovesLeft = state.minMovesLeft();
-	    const Move& move = buckets[bucketNr][i];
+// Position frame on its child move, skipping all children before it.
+// Returns false if there is no such child.
+static bool seekChild(Frame& frame, int depth, const Move& move) {
+    for (frame.bucketNr = 0; frame.bucketNr < 3; ++frame.bucketNr)
+	for (frame.childNr = 0;
+	     frame.childNr < frame.bucketsize[frame.bucketNr];
+	     ++frame.childNr)
+	    if (child(frame, depth) == move)
+		return true;
+    return false;
+}
+
+// Depth-first search below the current state, with an explicit stack so
+// that the search can be checkpointed and resumed: frames[d] describes the
+// node reached by path[0..d), and which of its children is searched.
+template<bool BACKWARD>
+static bool dfs() {
+    int rootDepth = state.moves();
+    int result = expand<BACKWARD>(frames[rootDepth]);
+    if (aborted)
+	return false;
+    if (result != EXPANDED)
+	return result == SOLVED;
 
+    for (;;) {
+	int depth = state.moves();
+	Frame& frame = frames[depth];
+	bool haveChild;
+	if (depth < int(resumePath.size())) {
+	    // everything before the child on the checkpointed path has
+	    // already been searched
+	    haveChild = seekChild(frame, depth, resumePath[depth]);
+	    if (!haveChild) {
+		resumeFailed = true;
+		return false;
+	    }
+	    if (depth == int(resumePath.size()) - 1)
+		resumePath.clear();
+	} else {
+	    haveChild = nextChild(frame);
+	}
+
+	if (!haveChild) {
+	    finish(frame);
+	    if (depth == rootDepth)
+		return false;
+	    Frame& parent = frames[depth - 1];
+	    state.undo(path[depth - 1], parent.minMovesLeft);
 #ifdef DO_MAY_MOVE_PRUNING
-	    bool mayMoveBak[NUM_ATOMS][4];
-	    for (int i = 0; i < NUM_ATOMS; ++i)
-		for (int j = 0; j < 4; ++j)
-		    mayMoveBak[i][j] = mayMove[i][j];
-
-	    if (state.moves() > 0) {
-		for (int d = 0; d < 4; ++d) {
-		    mayMove[move.atomNr()][d]
-			= (d != noOfDir(Dir(-move.dir())));
-		}
-#if 0 // buggy
-		if (move.atomNr() != lastMove.atomNr()) {
-		    if (!(between(lastMove.pos1(), lastMove.pos2(),
-				  lastMove.dir(), move.pos2())
-			  || move.pos2() + move.dir() == lastMove.pos2()
-			  || between(move.pos1(), move.pos2(), move.dir(),
-				     lastMove.pos1())
-			  || move.pos1() == lastMove.pos2() + lastMove.dir())){
-			for (int d = 0; d < 4; ++d)
-			    mayMove[lastMove.atomNr()][d] =  false;
-		    }
-		}
+	    memcpy(mayMove, parent.mayMoveBak, sizeof mayMove);
 #endif
+#ifdef DO_MOVE_ORDERING
+	    propagateCutoff(depth - 1);
+#endif
+	    continue;
+	}
+
+	const Move& move = child(frame, depth);
+#ifdef DO_MAY_MOVE_PRUNING
+	memcpy(frame.mayMoveBak, mayMove, sizeof mayMove);
+
+	if (state.moves() > 0) {
+	    for (int d = 0; d < 4; ++d) {
+		mayMove[move.atomNr()][d]
+		    = (d != noOfDir(Dir(-move.dir())));
 	    }
-	    // wake up others
-	    int moveDirNo = noOfDir(move.dir());
-	    int mmoveDirNo = noOfOppositeDir(move.dir());
-	    Dir perpDir;
-	    int perpDirNr, mperpDirNr;
-	    if (move.dir() == UP || move.dir() == DOWN) {
-		perpDir = LEFT;
-		perpDirNr = 2;
-		mperpDirNr = 3;
-	    } else {
-		perpDir = UP;
-		perpDirNr = 0;
-		mperpDirNr = 1;
-	    }
-	    // case 1
-	    Pos pp;
-	    // moved at least 2 fields?
-	    if (move.pos1() + move.dir() != move.pos2()) {
-		for (Pos p = move.pos1() + move.dir();
-		     //p != move.pos2() - move.dir(); p += move.dir()) {
-		     p != move.pos2(); p += move.dir()) {
-		    if (1 || state.isBlocking(p - perpDir)) {
-			for (pp = p + perpDir; !state.isBlocking(pp);
-			     pp += perpDir) { }
-			if (state.isAtom(pp))
-			    mayMove[state.atomNr(pp)][mperpDirNr] = true;
-		    }
-		    if (1 || state.isBlocking(p + perpDir)) {
-			for (pp = p - perpDir; !state.isBlocking(pp);
-			     pp -= perpDir) { }
-			if (state.isAtom(pp))
-			    mayMove[state.atomNr(pp)][perpDirNr] = true;
-		    }
+#if 0 // buggy
+	    const Move& lastMove = path[state.moves() - 1];
+	    if (move.atomNr() != lastMove.atomNr()) {
+		if (!(between(lastMove.pos1(), lastMove.pos2(),
+			      lastMove.dir(), move.pos2())
+		      || move.pos2() + move.dir() == lastMove.pos2()
+		      || between(move.pos1(), move.pos2(), move.dir(),
+				 lastMove.pos1())
+		      || move.pos1() == lastMove.pos2() + lastMove.dir())){
+		    for (int d = 0; d < 4; ++d)
+			mayMove[lastMove.atomNr()][d] =  false;
 		}
 	    }
-	    // case 1 special case
-	    for (pp = move.pos1() - move.dir(); !state.isBlocking(pp);
-		 pp -= move.dir()) { }
-	    if (state.isAtom(pp))
-		mayMove[state.atomNr(pp)][moveDirNo] = true;
-
-	    // case 2 & 3 
-	    for (pp = move.pos1() + perpDir; !state.isBlocking(pp);
-		 pp += perpDir) { }
-	    if (state.isAtom(pp))
-		mayMove[state.atomNr(pp)][mperpDirNr] = true;
-	    for (pp = move.pos1() - perpDir; !state.isBlocking(pp);
-		 pp -= perpDir) { }
-	    if (state.isAtom(pp))
-		mayMove[state.atomNr(pp)][perpDirNr] = true;
-	    // case 4
-	    if (state.isAtom(move.pos2() + move.dir()))
-		mayMove[state.atomNr(move.pos2() + move.dir())][mmoveDirNo]
-		    = true;
-#endif
-	    state.apply(move, oldMinMovesLeft + bucketNr - 1);	
-	    if (dfs(move)) {
-		solution.push_front(move);
-		return true;
-	    }
-	    state.undo(move, oldMinMovesLeft);
-#ifdef DO_MAY_MOVE_PRUNING
-	    for (int i = 0; i < NUM_ATOMS; ++i)
-		for (int j = 0; j < 4; ++j)
-		    mayMove[i][j] = mayMoveBak[i][j];
 #endif
-#ifdef DO_BACKWARD_SEARCH
 	}
-#endif
+	// wake up others
+	int moveDirNo = noOfDir(move.dir());
+	int mmoveDirNo = noOfOppositeDir(move.dir());
+	Dir perpDir;
+	int perpDirNr, mperpDirNr;
+	if (move.dir() == UP || move.dir() == DOWN) {
+	    perpDir = LEFT;
+	    perpDirNr = 2;
+	    mperpDirNr = 3;
+	} else {
+	    perpDir = UP;
+	    perpDirNr = 0;
+	    mperpDirNr = 1;
 	}
-    }
+	// case 1
+	Pos pp;
+	// moved at least 2 fields?
+	if (move.pos1() + move.dir() != move.pos2()) {
+	    for (Pos p = move.pos1() + move.dir();
+		 //p != move.pos2() - move.dir(); p += move.dir()) {
+		 p != move.pos2(); p += move.dir()) {
+		if (1 || state.isBlocking(p - perpDir)) {
+		    for (pp = p + perpDir; !state.isBlocking(pp);
+			 pp += perpDir) { }
+		    if (state.isAtom(pp))
+			mayMove[state.atomNr(pp)][mperpDirNr] = true;
+		}
+		if (1 || state.isBlocking(p + perpDir)) {
+		    for (pp = p - perpDir; !state.isBlocking(pp);
+			 pp -= perpDir) { }
+		    if (state.isAtom(pp))
+			mayMove[state.atomNr(pp)][perpDirNr] = true;
+		}
+	    }
+	}
+	// case 1 special case
+	for (pp = move.pos1() - move.dir(); !state.isBlocking(pp);
+	     pp -= move.dir()) { }
+	if (state.isAtom(pp))
+	    mayMove[state.atomNr(pp)][moveDirNo] = true;
 
-#ifdef DO_CACHING
-    if (cachedStates.capacityLeft() > 0
-#ifdef DO_STOCHASTIC_CACHING
-	&& double(rand()) / double(RAND_MAX)  <= CACHE_INSERT_PROBABILITY
+	// case 2 & 3 
+	for (pp = move.pos1() + perpDir; !state.isBlocking(pp);
+	     pp += perpDir) { }
+	if (state.isAtom(pp))
+	    mayMove[state.atomNr(pp)][mperpDirNr] = true;
+	for (pp = move.pos1() - perpDir; !state.isBlocking(pp);
+	     pp -= perpDir) { }
+	if (state.isAtom(pp))
+	    mayMove[state.atomNr(pp)][perpDirNr] = true;
+	// case 4
+	if (state.isAtom(move.pos2() + move.dir()))
+	    mayMove[state.atomNr(move.pos2() + move.dir())][mmoveDirNo]
+		= true;
 #endif
-	) {
-	cacheState.minMovesLeft = (maxMoves + 1) - state.moves();
-	cachedStates.insert(cacheState);
-    }
+	path[depth] = move;
+	state.apply(move, frame.minMovesLeft + frame.bucketNr - 1);
+	result = expand<BACKWARD>(frames[depth + 1]);
+	if (aborted)
+	    return false;
+	if (result == SOLVED) {
+	    solution.insert(solution.begin(), path.begin() + rootDepth,
+			    path.begin() + depth + 1);
+	    return true;
+	}
+	if (result == CUT_OFF) {
+	    state.undo(move, frame.minMovesLeft);
+#ifdef DO_MAY_MOVE_PRUNING
+	    memcpy(mayMove, frame.mayMoveBak, sizeof mayMove);
 #endif
-
-    return false;
+#ifdef DO_MOVE_ORDERING
+	    propagateCutoff(depth);
+#endif
+	}
+    }
 }
@@ -22,12 +22,15 @@
 #ifndef IDASTAR_HH
 #define IDASTAR_HH
 
+#include "stdint.h"
+
 #include <deque>
+#include <iosfwd>
+#include <vector>
 
 #include "Move.hh"
 
-#undef DO_BACKWARD_SEARCH	// normal forward search
-//#define DO_BACKWARD_SEARCH 1	// search from goal toward starting position
+struct SharedBounds;
 
 #undef DO_PREHEATING
 //#define DO_PREHEATING 1
@@ -38,47 +41,114 @@
 #undef DO_MAY_MOVE_PRUNING
 //#define DO_MAY_MOVE_PRUNING 1
 
+// order the children within each bucket by a history table, and with
+// DO_CACHING, by the best move of the last iteration first
+#undef DO_MOVE_ORDERING
+//#define DO_MOVE_ORDERING 1
+
 #undef DO_CACHING
 //#define DO_CACHING 1
 
 #undef DO_PARTIAL
 //#define DO_PARTIAL 1
 
+// DO_PARTIAL with a blocked Bloom filter, PARTIAL_PROBES bits per state
+#undef DO_BLOCKED_PARTIAL
+//#define DO_BLOCKED_PARTIAL 1
+#define PARTIAL_PROBES 3
+#if PARTIAL_PROBES < 1 || PARTIAL_PROBES > 7
+#error "PARTIAL_PROBES must be between 1 and 7, see BloomFilter.hh"
+#endif
+
 //#undef DO_COMPACTION
 #define DO_COMPACTION 1
 
+// a second cache tier on disk for states near the root; needs DO_CACHING
+#undef DO_DISK_CACHING
+//#define DO_DISK_CACHING 1
+
 #undef DO_STOCHASTIC_CACHING
 //#define DO_STOCHASTIC_CACHING 1
 
 #define CACHE_INSERT_PROBABILITY 0.1
 
-static const char* ALGORITHM_NAME = "idastar"
-#ifdef DO_BACKWARD_SEARCH
-  "-backward"
-#endif
-#ifndef DO_PREHEATING
-  "-nopreheat"
-#endif
-#ifndef DO_MOVE_PRUNING
-  "-nomoveprune"
-#endif
-#ifdef DO_MAY_MOVE_PRUNING
-  "-maymoveprune"
-#endif
-#if !defined(DO_CACHING) && !defined(DO_PARTIAL) && !defined(DO_COMPACTION)
-  "-nocaching"
-#endif
-#ifdef DO_PARTIAL
-  "-partial"
-#endif
-#ifdef DO_COMPACTION
-  "-compaction"
-#endif
-#ifdef DO_STOCHASTIC_CACHING
-  "-stochastic"
-#endif
-;
-
-deque<Move> IDAStar(int maxDist);
+// The name of the algorithm with the options above, like
+// "idastar-nopreheat-compaction".
+const char* IDAStarName();
+
+// Where a search was when it was checkpointed: path leads from the root to
+// the node that was about to be expanded, and everything to the left of it
+// has been searched already.
+struct IDAStarCheckpoint {
+    int maxMoves;
+    bool backward;
+    int nextMaxMoves;		// smallest f-value cut off so far
+    vector<Move> path;
+};
+
+ostream& operator<<(ostream& out, const IDAStarCheckpoint& position);
+istream& operator>>(istream& in, IDAStarCheckpoint& position);
+
+// The handler is called with the position of a running search every
+// interval seconds and after IDAStarStop().
+typedef void (*IDAStarCheckpointHandler)(const IDAStarCheckpoint& position);
+void IDAStarSetCheckpointHandler(IDAStarCheckpointHandler handler,
+				 int interval);
+
+// Stop searching when bounds are solved, that is, when a solution of at most
+// maxDist moves has been found elsewhere. nextMaxDist is then set to maxDist.
+void IDAStarSetBounds(const SharedBounds* bounds);
+
+// IDA*_CR [Sarkar et al. 1991]: when main() raises the bound by more than
+// one, a solution longer than bound may not be optimal. IDAStar() then keeps
+// it and goes on with the bound one below its length, and returns the
+// shortest solution of at most maxDist moves. The default, INT_MAX, returns
+// the first solution found.
+void IDAStarSetProvenBound(int bound);
+
+// Search nodes at most depth moves below the bound with a plain depth-first
+// search, without probing the transposition tables; they are too close to
+// the leaves for a probe to pay off. The default is LOOKAHEAD.
+void IDAStarSetLookahead(int depth);
+
+// How many nodes with each f-value the last IDAStar() cut off, indexed by
+// f. f-values more than CUTOFF_RANGE above its maxDist are not counted.
+static const int CUTOFF_RANGE = 8;
+const vector<uint64_t>& IDAStarCutoffs();
+
+// Make a running search checkpoint and exit. Returns false if no search is
+// running. Can be called from a signal handler.
+bool IDAStarStop();
+
+// Search for a solution with at most maxDist moves for the current goal of
+// Problem. A backward search starts from the goal and uses reverse moves;
+// the solution is returned as normal moves either way. If no solution is
+// found and nextMaxDist is given, it is set to the smallest f-value above
+// maxDist that was cut off, which is a lower bound for the solution length,
+// or to INT_MAX if nothing was cut off. If resume is given, the search
+// continues where that checkpoint was taken.
+deque<Move> IDAStar(int maxDist, bool backward = false,
+		    int* nextMaxDist = NULL,
+		    const IDAStarCheckpoint* resume = NULL);
+
+// Split the search of IDAStar() into subtrees: expand the root breadth-first
+// until there are at least minNodes nodes with an f-value of at most maxDist,
+// and return the move sequences leading to them in frontier, ordered like
+// the moves are generated. If a solution turns up on the way, it
+// is returned and frontier is empty. nextMaxDist is set to the smallest
+// f-value above maxDist that was cut off so far.
+deque<Move> IDAStarFrontier(int maxDist, bool backward, size_t minNodes,
+			    vector<vector<Move> >& frontier,
+			    int* nextMaxDist = NULL);
+
+// Search the subtree below prefix, which came from IDAStarFrontier(), like
+// IDAStar() would. The tables are kept between subtrees of the same
+// iteration.
+deque<Move> IDAStarSubtree(int maxDist, bool backward,
+			   const vector<Move>& prefix, int* nextMaxDist = NULL);
+
+// Guess whether backward search will be faster for the current goal, by
+// comparing the branching factors near start and goal.
+bool IDAStarPreferBackward();
 
 #endif
@@ -36,7 +36,11 @@ public:
     IDAStarCacheState() { }
     IDAStarCacheState(const IDAStarState& state)
 	: CacheState(state), minMovesFromStart(state.moves()),
-	  minMovesLeft(state.minMovesLeft()) { }
+	  minMovesLeft(state.minMovesLeft())
+#ifdef DO_MOVE_ORDERING
+	, bestMove(0)
+#endif
+    { }
 
     // This method will be called when "other" is inserted into the hash
     // table, and represents the same state as "*this".
@@ -45,10 +49,19 @@ public:
 	    minMovesFromStart = other.minMovesFromStart;
 	if (other.minMovesLeft > minMovesLeft)
 	    minMovesLeft = other.minMovesLeft;
+#ifdef DO_MOVE_ORDERING
+	if (other.bestMove != 0)
+	    bestMove = other.bestMove;
+#endif
     }
 
     unsigned char minMovesFromStart;
     unsigned char minMovesLeft;
+#ifdef DO_MOVE_ORDERING
+    // the move toward the smallest f-value cut off below this state in the
+    // last iteration, as 4 * atom number + direction number + 1; 0 if none
+    unsigned char bestMove;
+#endif
 } __attribute__ ((packed));
 
 #endif
@@ -32,25 +32,30 @@
 // * cache minMovesLeft
 // * keep a matrix of field content for faster move generation and easier move
 //   dependency checking
+// * keep a Zobrist hash, so the hash of a child is known without making the
+//   move
 
 class IDAStarState : public State {
 private:
     void calcMinMovesLeft() {
-#ifndef DO_BACKWARD_SEARCH
-	minMovesLeft_ = State::minMovesLeft();
-#else
-	minMovesLeft_ = State::rminMovesLeft();
-#endif
+	if (!backward_)
+	    minMovesLeft_ = State::minMovesLeft();
+	else
+	    minMovesLeft_ = State::rminMovesLeft();
     }
 public:
     // leave uninitialized
     IDAStarState() { }
-    IDAStarState(const State& state)
-	: State(state), moves_(0) {
+    // for a backward search, the heuristic estimates the distance to the
+    // starting position instead of the goal.
+    IDAStarState(const State& state, bool backward = false)
+	: State(state), backward_(backward), moves_(0), zobrist_(0) {
 	for (Pos pos = 0; pos != Pos::end(); ++pos)
 	    fields_[pos.fieldNumber()] = Problem::isBlock(pos) ? BLOCK : EMPTY;
-	for (int i = 0; i < NUM_ATOMS; ++i)
+	for (int i = 0; i < NUM_ATOMS; ++i) {
 	    fields_[atomPosition(i)] = i;
+	    zobrist_ ^= Problem::zobristKey(i, atomPosition(i));
+	}
 	
 	calcMinMovesLeft();
     }
@@ -60,18 +65,37 @@ public:
     int minMovesLeft() const { return minMovesLeft_; }
     int minTotalMoves() const { return moves_ + minMovesLeft_; }
 
+    uint64_t zobrist() const { return zobrist_; }
+    // the hash after move, without making it
+    uint64_t zobrist(const Move& move) const {
+	return zobrist_ ^ Problem::zobristKey(move.atomNr(), move.pos1())
+	    ^ Problem::zobristKey(move.atomNr(), move.pos2());
+    }
+    // minMovesLeft() after a move of a unique atom, without making it
+    int uniqueMinMovesLeft(const Move& move) const {
+	if (!backward_)
+	    return minMovesLeft_
+		+ Problem::goalDistByte(move.atomNr(), move.pos2())
+		- Problem::goalDistByte(move.atomNr(), move.pos1());
+	else
+	    return minMovesLeft_
+		+ Problem::rgoalDistByte(move.atomNr(), move.pos2())
+		- Problem::rgoalDistByte(move.atomNr(), move.pos1());
+    }
+
     void apply(const Move& move) {
 	State::apply(move);
 	fields_[move.pos1().fieldNumber()] = EMPTY;
 	fields_[move.pos2().fieldNumber()] = move.atomNr();
+	zobrist_ = zobrist(move);
 	if (move.atomNr() < NUM_UNIQUE) {
-#ifndef DO_BACKWARD_SEARCH
-	    minMovesLeft_ -= Problem::goalDist(move.atomNr(), move.pos1());
-	    minMovesLeft_ += Problem::goalDist(move.atomNr(), move.pos2());
-#else
-	    minMovesLeft_ -= Problem::rgoalDist(move.atomNr(), move.pos1());
-	    minMovesLeft_ += Problem::rgoalDist(move.atomNr(), move.pos2());
-#endif
+	    if (!backward_) {
+		minMovesLeft_ -= Problem::goalDist(move.atomNr(), move.pos1());
+		minMovesLeft_ += Problem::goalDist(move.atomNr(), move.pos2());
+	    } else {
+		minMovesLeft_ -= Problem::rgoalDist(move.atomNr(), move.pos1());
+		minMovesLeft_ += Problem::rgoalDist(move.atomNr(), move.pos2());
+	    }
 	/*
 	} else if (move.atomNr() < NUM_PAIRED) {
 	    int other;
@@ -100,7 +124,8 @@ public:
     void apply(const Move& move, int minMovesLeft) {
 	State::apply(move);
 	fields_[move.pos1().fieldNumber()] = EMPTY;
-	fields_[move.pos2().fieldNumber()] = move.atomNr();;
+	fields_[move.pos2().fieldNumber()] = move.atomNr();
+	zobrist_ = zobrist(move);
 	minMovesLeft_ = minMovesLeft;
 	++moves_;
     }
@@ -108,6 +133,7 @@ public:
 	State::undo(move);
 	fields_[move.pos1().fieldNumber()] = move.atomNr();
 	fields_[move.pos2().fieldNumber()] = EMPTY;
+	zobrist_ = zobrist(move);
 	minMovesLeft_ = minMovesLeft;
 	--moves_;
     }
@@ -120,8 +146,10 @@ private:
     enum { EMPTY = NUM_ATOMS, BLOCK = NUM_ATOMS + 1 };
     void undo(const Move& move); // shouldn't be used
 
+    bool backward_;
     unsigned int moves_;
     unsigned int minMovesLeft_;
+    uint64_t zobrist_;
     int fields_[NUM_FIELDS];	// FIXME try whether char is faster
 };
 
@@ -0,0 +1,237 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include "LargeMemory.hh"
+#include "parameters.hh"
+
+using namespace std;
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << 26)
+#endif
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
+bool LargeMemory::myInterleaved;
+size_t LargeMemory::myBudget;
+
+struct Usage {
+    const char* what;
+    size_t current, peak;
+};
+
+// there are only a handful of structures
+static const int MAX_USAGES = 16;
+static Usage usages[MAX_USAGES];
+static int numUsages;
+static pthread_mutex_t usageMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void account(const char* what, size_t size, bool add) {
+    pthread_mutex_lock(&usageMutex);
+    int i;
+    for (i = 0; i < numUsages && strcmp(usages[i].what, what) != 0; ++i) { }
+    if (i == numUsages && numUsages < MAX_USAGES) {
+	usages[i].what = what;
+	++numUsages;
+    }
+    if (i < numUsages) {
+	if (add) {
+	    usages[i].current += size;
+	    if (usages[i].current > usages[i].peak)
+		usages[i].peak = usages[i].current;
+	} else {
+	    usages[i].current -= size;
+	}
+    }
+    pthread_mutex_unlock(&usageMutex);
+}
+
+static size_t roundUp(size_t size) {
+    if (size == 0)
+	size = 1;
+    return (size + LargeMemory::HUGE_PAGE_SIZE - 1)
+	& ~(LargeMemory::HUGE_PAGE_SIZE - 1);
+}
+
+// the online NUMA nodes as a bit mask, 0 if there is only one or we can't
+// tell
+static unsigned long onlineNodes() {
+    FILE* f = fopen("/sys/devices/system/node/online", "r");
+    if (f == NULL)
+	return 0;
+    char line[256];
+    bool ok = fgets(line, sizeof line, f) != NULL;
+    fclose(f);
+    if (!ok)
+	return 0;
+    // a list of ranges like "0-3,6"
+    unsigned long nodes = 0;
+    for (char* s = line; *s >= '0' && *s <= '9'; ) {
+	unsigned long from = strtoul(s, &s, 10), to = from;
+	if (*s == '-')
+	    to = strtoul(s + 1, &s, 10);
+	for (unsigned long n = from; n <= to && n < 8 * sizeof nodes; ++n)
+	    nodes |= 1UL << n;
+	if (*s == ',')
+	    ++s;
+    }
+    return (nodes & (nodes - 1)) == 0 ? 0 : nodes;
+}
+
+static void interleave(void* p, size_t length) {
+    static unsigned long nodes = onlineNodes();
+    // must happen before the pages are touched; if it fails, they just
+    // stay local
+    if (nodes != 0)
+	syscall(SYS_mbind, p, length, MPOL_INTERLEAVE, &nodes,
+		8 * sizeof nodes + 1, 0);
+}
+
+void* LargeMemory::allocate(size_t size, const char* what) {
+    size_t length = roundUp(size);
+    // fails right away if not enough huge pages are reserved
+    void* p = mmap(NULL, length, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB,
+		   -1, 0);
+    if (p == MAP_FAILED) {
+	// Transparent huge pages only fill aligned 2 MB, so map a bit more
+	// and cut off what sticks out.
+	char* q = static_cast<char*>(
+	    mmap(NULL, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if (q == MAP_FAILED)
+	    throw bad_alloc();
+	char* start = reinterpret_cast<char*>(
+	    roundUp(reinterpret_cast<size_t>(q)));
+	if (start != q)
+	    munmap(q, start - q);
+	munmap(start + length, q + HUGE_PAGE_SIZE - start);
+	madvise(start, length, MADV_HUGEPAGE);
+	p = start;
+    }
+    if (myInterleaved)
+	interleave(p, length);
+    account(what, length, true);
+    return p;
+}
+
+void LargeMemory::release(void* p, size_t size, const char* what) {
+    if (p != NULL) {
+	munmap(p, roundUp(size));
+	account(what, roundUp(size), false);
+    }
+}
+
+// a number from a file in /proc or /sys, or 0 if there is none, as in
+// "max"
+static size_t readNumber(const string& fileName, const char* key = NULL) {
+    ifstream in(fileName.c_str());
+    string word;
+    while (in >> word) {
+	if (key != NULL && word != key)
+	    continue;
+	size_t n;
+	if (key != NULL)
+	    in >> n;
+	else
+	    n = strtoull(word.c_str(), NULL, 10);
+	return in ? n : 0;
+    }
+    return 0;
+}
+
+size_t LargeMemory::available() {
+    size_t result = readNumber("/proc/meminfo", "MemAvailable:") * 1024;
+
+    // our cgroup: "0::/path" for version 2, "n:memory:/path" for version 1
+    ifstream cgroups("/proc/self/cgroup");
+    string line;
+    while (getline(cgroups, line)) {
+	size_t colon1 = line.find(':'), colon2 = line.find(':', colon1 + 1);
+	if (colon2 == string::npos)
+	    continue;
+	string controllers = line.substr(colon1 + 1, colon2 - colon1 - 1);
+	string path = line.substr(colon2 + 1);
+	if (path == "/")
+	    path = "";
+	size_t limit = 0;
+	if (controllers.empty())
+	    limit = readNumber("/sys/fs/cgroup" + path + "/memory.max");
+	else if (controllers == "memory")
+	    limit = readNumber("/sys/fs/cgroup/memory" + path
+			       + "/memory.limit_in_bytes");
+	// version 1 says "no limit" with a huge number
+	if (limit != 0 && limit < (size_t(1) << 60)
+	    && (result == 0 || limit < result))
+	    result = limit;
+    }
+    return result;
+}
+
+size_t LargeMemory::budget() {
+    if (myBudget == 0) {
+	size_t avail = available();
+	myBudget = avail != 0 ? size_t(avail * MEMORY_FRACTION) : MEMORY;
+    }
+    return myBudget;
+}
+
+size_t LargeMemory::parseSize(const string& s) {
+    istringstream in(s);
+    double size;
+    if (!(in >> size) || size <= 0)
+	return 0;
+    char unit = 0;
+    in >> unit;
+    switch (unit) {
+    case 'G': case 'g': size *= 1024;	// fall through
+    case 'M': case 'm': size *= 1024;	// fall through
+    case 'K': case 'k': size *= 1024;	// fall through
+    case 0: break;
+    default: return 0;
+    }
+    return size_t(size);
+}
+
+void LargeMemory::printUsage(ostream& out) {
+    pthread_mutex_lock(&usageMutex);
+    out << " Memory budget:    " << budget() / (1024 * 1024) << " MB\n";
+    for (int i = 0; i < numUsages; ++i)
+	out << "  " << usages[i].what << ": "
+	    << usages[i].current / (1024 * 1024) << " MB, peak "
+	    << usages[i].peak / (1024 * 1024) << " MB\n";
+    pthread_mutex_unlock(&usageMutex);
+}
@@ -0,0 +1,132 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#ifndef LARGEMEMORY_HH
+#define LARGEMEMORY_HH
+
+#include <stddef.h>
+#include <string.h>
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+// Memory for the big search tables. They are probed at random, so with 4 KB
+// pages almost every probe also misses the TLB. Blocks are mapped with
+// explicit 2 MB huge pages if the system has them reserved, and otherwise
+// with transparent huge pages. The kernel hands out pages zeroed when they
+// are first touched, so a table that is never filled costs nothing, and
+// nobody has to clear it. If several threads probe a table, its pages are
+// spread over all NUMA nodes instead of all landing on the node of the
+// thread that allocated it.
+//
+// The engines size their tables from budget(), which is set with --memory,
+// or else is MEMORY_FRACTION of what the machine or the cgroup we run in
+// has available. The blocks are accounted by the structure they are for, so
+// that printUsage() can tell where the memory went.
+
+class LargeMemory {
+public:
+    // Blocks smaller than this aren't worth a mapping of their own.
+    static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    // Return size bytes of zeroed memory, aligned to a page; throws
+    // bad_alloc on failure.
+    static void* allocate(size_t size, const char* what);
+    static void release(void* p, size_t size, const char* what);
+
+    static size_t budget();
+    static void setBudget(size_t budget) { myBudget = budget; }
+    // the smaller of the cgroup's memory limit and MemAvailable, or 0 if
+    // neither can be read
+    static size_t available();
+    // parse a size like 512M or 6G; returns 0 if it is none
+    static size_t parseSize(const std::string& s);
+
+    // current and peak size of the blocks of each structure
+    static void printUsage(std::ostream& out);
+
+    // Interleave blocks allocated from now on over the NUMA nodes.
+    static void setInterleaved(bool interleaved) {
+	myInterleaved = interleaved;
+    }
+
+private:
+    static bool myInterleaved;
+    static size_t myBudget;
+};
+
+// An allocator for the containers of the search tables: blocks of at least
+// HUGE_PAGE_SIZE come from LargeMemory, accounted to what, smaller ones from
+// the heap.
+template<typename T>
+class LargeAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<typename U> struct rebind { typedef LargeAllocator<U> other; };
+
+    explicit LargeAllocator(const char* what = "other") : myWhat(what) { }
+    template<typename U> LargeAllocator(const LargeAllocator<U>& a)
+	: myWhat(a.what()) { }
+
+    const char* what() const { return myWhat; }
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+    size_type max_size() const { return size_t(-1) / sizeof(T); }
+
+    pointer allocate(size_type n, const void* = 0) {
+	if (n * sizeof(T) < LargeMemory::HUGE_PAGE_SIZE)
+	    return std::allocator<T>().allocate(n);
+	return static_cast<T*>(LargeMemory::allocate(n * sizeof(T), myWhat));
+    }
+    void deallocate(pointer p, size_type n) {
+	if (n * sizeof(T) < LargeMemory::HUGE_PAGE_SIZE)
+	    std::allocator<T>().deallocate(p, n);
+	else
+	    LargeMemory::release(p, n * sizeof(T), myWhat);
+    }
+
+private:
+    const char* myWhat;
+};
+
+// blocks are accounted to what, so only allocators for the same structure
+// can free each other's blocks
+template<typename T, typename U>
+inline bool operator==(const LargeAllocator<T>& a,
+		       const LargeAllocator<U>& b) {
+    return strcmp(a.what(), b.what()) == 0;
+}
+template<typename T, typename U>
+inline bool operator!=(const LargeAllocator<T>& a,
+		       const LargeAllocator<U>& b) {
+    return !(a == b);
+}
+
+#endif
@@ -39,6 +39,21 @@ Level::Level(istream& in) {
 	lines[key] = value;
     }
 
+    // FNV-1a over everything that affects the puzzle, but not e. g. the name
+    myHash = 14695981039346656037ULL;
+    for (map<string, string>::const_iterator p = lines.begin();
+	 p != lines.end(); ++p) {
+	if (p->first.compare(0, 5, "feld_") != 0
+	    && p->first.compare(0, 5, "mole_") != 0
+	    && p->first.compare(0, 5, "atom_") != 0)
+	    continue;
+	string line = p->first + '=' + p->second + '\n';
+	for (string::size_type i = 0; i < line.length(); ++i) {
+	    myHash ^= (unsigned char) line[i];
+	    myHash *= 1099511628211ULL;
+	}
+    }
+
     myStartBoard = Board(lines, "feld", 2);
     myGoal       = Board(lines, "mole", 1);
     findGoalPositions();
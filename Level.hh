@@ -22,6 +22,8 @@
 #ifndef LEVEL_HH
 #define LEVEL_HH
 
+#include "stdint.h"
+
 #include <iosfwd>
 #include <vector>
 
@@ -40,12 +42,15 @@ public:
     void printStats() const;
     Pos goalPos(int goalPosNr) const { return myGoalPositions[goalPosNr]; }
     int numGoals() const { return myGoalPositions.size(); }
+    // identifies the level by its content, independent of name and file
+    uint64_t hash() const { return myHash; }
 
 private:
     void findGoalPositions();
 
     vector<Pos> myGoalPositions;
     Board myStartBoard, myGoal;
+    uint64_t myHash;
 };
 
 ostream& operator<<(ostream& out, const Level& level);
@@ -28,3 +28,18 @@ ostream& operator <<(ostream& out, const Move& move) {
 	       << "->" << move.pos2();
 }
 
+// reads the format written by operator<<
+istream& operator >>(istream& in, Move& move) {
+    int atomNr;
+    char at, arrow1, arrow2;
+    Pos pos1, pos2;
+    Dir dir;
+    if (in >> atomNr >> at >> pos1 >> dir >> arrow1 >> arrow2 >> pos2) {
+	if (at != '@' || arrow1 != '-' || arrow2 != '>')
+	    in.setstate(ios::failbit);
+	else
+	    move = Move(atomNr, pos1, pos2, dir);
+    }
+    return in;
+}
+
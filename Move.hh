@@ -40,6 +40,11 @@ public:
     Pos pos2() const { return myPos2; }
     Dir dir() const { return myDir; }
 
+    bool operator==(const Move& other) const {
+	return myAtomNr == other.myAtomNr && myPos1 == other.myPos1
+	    && myPos2 == other.myPos2;
+    }
+
 private:
     int myAtomNr;
     Pos myPos1, myPos2;
@@ -47,5 +52,6 @@ private:
 };
 
 ostream& operator <<(ostream& out, const Move& move);
+istream& operator >>(istream& in, Move& move);
 
 #endif
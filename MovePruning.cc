@@ -0,0 +1,166 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#include "stdint.h"
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "CacheState.hh"
+#include "HashTable.hh"
+#include "MovePruning.hh"
+#include "PrecomputedCache.hh"
+#include "Problem.hh"
+#include "State.hh"
+
+using namespace std;
+
+// don't enumerate more sequences than this while learning
+static const uint64_t LEARN_MAX_SEQUENCES = 2000000;
+
+// myLearnedFor[] before the first learn()
+static const int NOT_LEARNED = PrecomputedCache::ANY_GOAL - 1;
+
+int MovePruning::myWindow[2] = { 1, 1 };
+int MovePruning::myLearnedFor[2] = { NOT_LEARNED, NOT_LEARNED };
+// the windows learned so far by goal, so that searches switching between
+// the goals need not learn them again
+static map<int, int> learnedWindows[2];
+
+// number of sequences that survive pruning with window w; w = 0 means no
+// pruning at all
+static uint64_t survivors[MAX_PRUNING_WINDOW + 1];
+static HashTable<CacheState> allStates, keptStates;
+
+static void addState(HashTable<CacheState>& states, const State& state) {
+    CacheState cacheState(state);
+    if (states.find(cacheState) == NULL)
+	states.insertNew(cacheState);
+}
+
+// enumerate all sequences up to length maxDepth that extend path[0..depth).
+// prunedAt is the smallest window that prunes the sequence so far.
+template<bool BACKWARD>
+static void enumerate(const State& state, Move* path, int depth, int maxDepth,
+		      int prunedAt) {
+    if (depth == maxDepth)
+	return;
+
+    vector<Move> moves = BACKWARD ? state.rmoves() : state.moves();
+    for (vector<Move>::const_iterator m = moves.begin();
+	 m != moves.end(); ++m) {
+	int distance = MovePruning::pruneDistance<BACKWARD>(
+	    path, depth, *m, MAX_PRUNING_WINDOW);
+	int newPrunedAt = prunedAt;
+	if (distance != 0 && distance < newPrunedAt)
+	    newPrunedAt = distance;
+	for (int w = 0; w <= MAX_PRUNING_WINDOW; ++w)
+	    if (w < newPrunedAt)
+		++survivors[w];
+
+	State newState(state, *m);
+	addState(allStates, newState);
+	if (newPrunedAt > MAX_PRUNING_WINDOW)
+	    addState(keptStates, newState);
+
+	path[depth] = *m;
+	enumerate<BACKWARD>(newState, path, depth + 1, maxDepth, newPrunedAt);
+    }
+}
+
+void MovePruning::learn(const State& start, bool backward) {
+    // a forward search always starts from the same state, a backward one
+    // from the goal
+    int goal = backward ? Problem::goalOffset() : PrecomputedCache::ANY_GOAL;
+    if (myLearnedFor[backward] == goal)
+	return;
+    myLearnedFor[backward] = goal;
+    map<int, int>::const_iterator known = learnedWindows[backward].find(goal);
+    if (known != learnedWindows[backward].end()) {
+	myWindow[backward] = known->second;
+	return;
+    }
+
+    const char* kind = backward ? "rpruning" : "pruning";
+    const int32_t* learned = static_cast<const int32_t*>(
+	PrecomputedCache::find(Problem::levelHash(), goal, kind,
+			       sizeof(int32_t)));
+    if (learned != NULL) {
+	myWindow[backward] = *learned;
+	cout << "Move pruning" << (backward ? " (backward)" : "")
+	     << ": using window " << *learned << " learned earlier" << endl;
+    } else {
+	learnWindow(start, backward);
+	int32_t window = myWindow[backward];
+	PrecomputedCache::store(Problem::levelHash(), goal, kind, &window,
+				sizeof window);
+    }
+    learnedWindows[backward][goal] = myWindow[backward];
+}
+
+void MovePruning::learnWindow(const State& start, bool backward) {
+    int branching = (backward ? start.rmoves() : start.moves()).size();
+    Move path[MAX_PRUNING_WINDOW + 1];
+    int depth;
+
+    int& chosen = myWindow[backward];
+    chosen = 1;
+    for (depth = 2; depth <= MAX_PRUNING_WINDOW + 1; ++depth) {
+	for (int w = 0; w <= MAX_PRUNING_WINDOW; ++w)
+	    survivors[w] = 0;
+	allStates.clear(1024);
+	keptStates.clear(1024);
+	addState(allStates, start);
+	addState(keptStates, start);
+	if (backward)
+	    enumerate<true>(start, path, 0, depth, MAX_PRUNING_WINDOW + 1);
+	else
+	    enumerate<false>(start, path, 0, depth, MAX_PRUNING_WINDOW + 1);
+
+	if (keptStates.size() != allStates.size()) {
+	    // this means there is a bug in independent()
+	    cerr << "Warning: move pruning loses "
+		 << allStates.size() - keptStates.size() << " of "
+		 << allStates.size() << " states at depth " << depth
+		 << "; using window 1\n";
+	    chosen = 1;
+	    return;
+	}
+	if (survivors[0] * branching > LEARN_MAX_SEQUENCES)
+	    break;
+    }
+    if (depth > MAX_PRUNING_WINDOW + 1)
+	depth = MAX_PRUNING_WINDOW + 1;
+
+    // a window larger than depth - 1 can't make a difference for the
+    // sequences we enumerated
+    int maxWindow = depth - 1;
+    chosen = maxWindow;
+    while (chosen > 1 && survivors[chosen - 1] == survivors[maxWindow])
+	--chosen;
+
+    cout << "Move pruning" << (backward ? " (backward)" : "") << ": "
+	 << survivors[0] << " sequences of length <= " << depth << ", " << allStates.size() << " states;";
+    for (int w = 1; w <= maxWindow; ++w)
+	cout << " window " << w << ": " << survivors[w];
+    cout << "; using window " << chosen << endl;
+}
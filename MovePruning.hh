@@ -0,0 +1,136 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#ifndef MOVEPRUNING_HH
+#define MOVEPRUNING_HH
+
+#include <stdlib.h>
+
+#include "Dir.hh"
+#include "Move.hh"
+#include "Pos.hh"
+
+class State;
+
+// Move pruning for the depth-first searches. A move sequence is only searched
+// if no equivalent sequence is smaller, where smaller means shorter, or of
+// equal length and lexicographically smaller in atom numbers. Two sequences
+// are considered equivalent if one can be obtained from the other by
+// swapping adjacent independent moves, or by replacing a move of an atom and
+// its later reversal by just the reversal.
+//
+// In Atomix, whether two moves commute depends on where the atoms are, so
+// there is no useful automaton over (atom, direction) labels alone. Instead,
+// the state of the pruning automaton is the last window() moves of the path,
+// which pruneDistance() walks backwards until it finds a move the new move
+// depends on. The window size for each direction is chosen by learn() when a
+// level is loaded.
+
+static const int MAX_PRUNING_WINDOW = 4;
+
+// is pm on the way from p1 to p2 (inclusive)?
+static inline bool between(Pos p1, Pos p2, Dir dir, Pos pm) {
+    switch(dir) {
+    case UP:
+	return p1.x() == pm.x() && p2 <= pm && pm <= p1;
+    case DOWN:
+	return p1.x() == pm.x() && p1 <= pm && pm <= p2;
+    case LEFT:
+	return p2 <= pm && pm <= p1;
+    case RIGHT:
+	return p1 <= pm && pm <= p2;
+    default:
+	abort();
+    }
+    return false;		// Compaq C++ just doesn't get it...
+}
+
+// Can "later", which was generated directly after "earlier", be swapped with
+// it without changing where either atom ends up? BACKWARD selects reverse
+// moves, where the atom is pulled away from a blocking field.
+template<bool BACKWARD>
+static inline bool independent(const Move& earlier, const Move& later) {
+    if (!BACKWARD)
+	return !(between(earlier.pos1(), earlier.pos2(),
+			 earlier.dir(), later.pos2())
+		 || later.pos2() + later.dir() == earlier.pos2()
+		 || between(later.pos1(), later.pos2(), later.dir(),
+			    earlier.pos1())
+		 || later.pos1() == earlier.pos2() + earlier.dir());
+    else
+	return !(between(earlier.pos1(), earlier.pos2(),
+			 earlier.dir(), later.pos2())
+		 || later.pos1() - later.dir() == earlier.pos2()
+		 || between(later.pos1(), later.pos2(), later.dir(),
+			    earlier.pos1())
+		 || later.pos1() == earlier.pos1() - earlier.dir());
+}
+
+class MovePruning {
+public:
+    // Enumerate all short move sequences from start, check that pruning
+    // loses no state, and pick the smallest window that prunes as much as
+    // the largest one. Only done once for each direction, and for each goal
+    // going backward, and the window is kept in the PrecomputedCache.
+    static void learn(const State& start, bool backward);
+
+    static int window(bool backward) { return myWindow[backward]; }
+
+    // Return how many moves back from the end of path[0..depth) the reason
+    // for pruning move was found, or 0 if move is not to be pruned. Only
+    // the last maxWindow moves are looked at.
+    template<bool BACKWARD>
+    static int pruneDistance(const Move* path, int depth, const Move& move,
+			     int maxWindow) {
+	for (int j = depth - 1; j >= 0 && j >= depth - maxWindow; --j) {
+	    const Move& prev = path[j];
+	    if (prev.atomNr() == move.atomNr()) {
+		// undoing an earlier move of the same atom can be done right
+		// away instead
+		if (move.dir() == -prev.dir())
+		    return depth - j;
+		return 0;
+	    }
+	    if (!independent<BACKWARD>(prev, move))
+		return 0;
+	    // move could be swapped in front of prev
+	    if (move.atomNr() < prev.atomNr())
+		return depth - j;
+	}
+	return 0;
+    }
+
+    template<bool BACKWARD>
+    static bool isPruned(const Move* path, int depth, const Move& move) {
+	return pruneDistance<BACKWARD>(path, depth, move,
+				       myWindow[BACKWARD]) != 0;
+    }
+
+private:
+    static void learnWindow(const State& start, bool backward);
+
+    static int myWindow[2];	// indexed by backward
+    // the goal offset the window was learned for, PrecomputedCache::ANY_GOAL
+    // going forward
+    static int myLearnedFor[2];
+};
+
+#endif
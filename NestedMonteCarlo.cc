@@ -0,0 +1,221 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#include <limits.h>
+#include <pthread.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "MovePruning.hh"
+#include "NestedMonteCarlo.hh"
+#include "Problem.hh"
+#include "State.hh"
+#include "Statistics.hh"
+
+using namespace std;
+
+static const uint64_t SEED = 20000;
+
+// unsolved sequences score this plus the estimate of moves left
+static const int UNSOLVED = 1000;
+
+// relative probability of a playout move that changes the estimate by
+// -1, 0 or +1
+static const int BIAS[3] = { 16, 4, 1 };
+
+// xorshift64*, so that each thread has its own reproducible sequence
+class Random {
+public:
+    Random(uint64_t seed) : x(seed * 0x9e3779b97f4a7c15ULL + 1) { }
+    uint64_t next() {
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	return x * 2685821657736338717ULL;
+    }
+
+private:
+    uint64_t x;
+};
+
+struct Sequence {
+    Sequence() : score(INT_MAX) { }
+    int score;			// length if solved, lower is better
+    vector<Move> moves;
+};
+
+static pthread_mutex_t outputMutex = PTHREAD_MUTEX_INITIALIZER;
+static int searchLevel;
+
+// the moves from state that are worth trying after path
+static vector<Move> candidates(const State& state, const vector<Move>& path) {
+    vector<Move> moves = state.moves();
+    vector<Move> result;
+    for (vector<Move>::const_iterator m = moves.begin(); m != moves.end(); ++m)
+	if (!MovePruning::isPruned<false>(path.empty() ? NULL : &path[0],
+					  path.size(), *m))
+	    result.push_back(*m);
+    return result;
+}
+
+// Each thread searches on its own, pruning with the bound from its own
+// solutions only, so that what it finds depends only on its seed and not on
+// how the threads are scheduled. The best solution is picked once all are
+// done.
+class Searcher {
+public:
+    Searcher(int nthreadNr, int nmaxLength)
+	: threadNr(nthreadNr), random(SEED + nthreadNr),
+	  statesGenerated(0), statesExpanded(0), maxLength(nmaxLength) { }
+
+    void run() {
+	State start(Problem::startPositions());
+	vector<Move> path;
+	nested(searchLevel, start, path);
+    }
+
+    int threadNr;
+    Random random;
+    uint64_t statesGenerated, statesExpanded;
+    Sequence best;
+
+private:
+    int maxLength;
+
+
+    int score(const State& state, const vector<Move>& path) {
+	int minMovesLeft = state.minMovesLeft();
+	if (minMovesLeft != 0)
+	    return UNSOLVED + minMovesLeft;
+	if (int(path.size()) <= maxLength)
+	    report(path);
+	return path.size();
+    }
+
+    void report(const vector<Move>& path) {
+	if (int(path.size()) >= best.score)
+	    return;
+	best.score = path.size();
+	best.moves = path;
+	maxLength = path.size() - 1;
+	pthread_mutex_lock(&outputMutex);
+	cout << "Thread " << threadNr << " found a solution in "
+	     << path.size() << " moves" << endl;
+	pthread_mutex_unlock(&outputMutex);
+    }
+
+    Sequence playout(State state, vector<Move> path) {
+	for (;;) {
+	    if (state.minMovesLeft() == 0
+		|| int(path.size()) + state.minMovesLeft() > maxLength)
+		break;
+	    vector<Move> moves = candidates(state, path);
+	    ++statesExpanded;
+	    if (moves.empty())
+		break;
+	    vector<int> weights(moves.size());
+	    int total = 0;
+	    for (size_t i = 0; i < moves.size(); ++i) {
+		int delta = State(state, moves[i]).minMovesLeft()
+		    - state.minMovesLeft();
+		weights[i] = BIAS[delta + 1];
+		total += weights[i];
+	    }
+	    statesGenerated += moves.size();
+	    int r = random.next() % total;
+	    size_t i = 0;
+	    while (r >= weights[i])
+		r -= weights[i++];
+	    state.apply(moves[i]);
+	    path.push_back(moves[i]);
+	}
+
+	Sequence sequence;
+	sequence.score = score(state, path);
+	sequence.moves.swap(path);
+	return sequence;
+    }
+
+    Sequence nested(int level, State state, vector<Move> path) {
+	if (level == 0)
+	    return playout(state, path);
+
+	Sequence bestHere;
+	for (;;) {
+	    if (state.minMovesLeft() == 0
+		|| int(path.size()) + state.minMovesLeft() > maxLength)
+		break;
+	    vector<Move> moves = candidates(state, path);
+	    ++statesExpanded;
+	    for (vector<Move>::const_iterator m = moves.begin();
+		 m != moves.end(); ++m) {
+		path.push_back(*m);
+		Sequence sequence = nested(level - 1, State(state, *m), path);
+		path.pop_back();
+		if (sequence.score < bestHere.score)
+		    bestHere = sequence;
+	    }
+	    // follow the best sequence found so far
+	    if (bestHere.moves.size() <= path.size())
+		break;
+	    const Move& move = bestHere.moves[path.size()];
+	    state.apply(move);
+	    path.push_back(move);
+	}
+	if (bestHere.score == INT_MAX)
+	    bestHere.score = score(state, path);
+	return bestHere;
+    }
+};
+
+static void* runSearcher(void* arg) {
+    static_cast<Searcher*>(arg)->run();
+    return NULL;
+}
+
+deque<Move> nestedMonteCarlo(int level, int maxLength, int numThreads) {
+    searchLevel = level;
+    MovePruning::learn(State(Problem::startPositions()), false);
+
+    vector<Searcher> searchers;
+    for (int t = 0; t < numThreads; ++t)
+	searchers.push_back(Searcher(t, maxLength));
+    vector<pthread_t> threads(numThreads);
+    Statistics::timer.start();
+    for (int t = 0; t < numThreads; ++t)
+	if (pthread_create(&threads[t], NULL, runSearcher, &searchers[t]) != 0)
+	    throw runtime_error("cannot create thread");
+    for (int t = 0; t < numThreads; ++t) {
+	pthread_join(threads[t], NULL);
+	Statistics::statesGenerated += searchers[t].statesGenerated;
+	Statistics::statesExpanded += searchers[t].statesExpanded;
+    }
+    Statistics::timer.stop();
+
+    // on ties, the lowest thread number wins
+    const Sequence* best = &searchers[0].best;
+    for (int t = 1; t < numThreads; ++t)
+	if (searchers[t].best.score < best->score)
+	    best = &searchers[t].best;
+    return deque<Move>(best->moves.begin(), best->moves.end());
+}
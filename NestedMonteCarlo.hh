@@ -0,0 +1,40 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#ifndef NESTEDMONTECARLO_HH
+#define NESTEDMONTECARLO_HH
+
+#include <deque>
+
+#include "Move.hh"
+
+// Nested Monte-Carlo search [Cazenave 2009] for the current goal of
+// Problem. Level 0 is a random playout that prefers moves which bring the
+// heuristic estimate down; at level n, every move is tried with a level n-1
+// search, and the best sequence found so far is followed by one move. Each
+// of numThreads threads runs its own search with a fixed seed and its own
+// length bound, so a run gives the same result each time for a given
+// number of threads. Only solutions of at most maxLength moves count.
+// Improvements are printed as they are found; the best solution is
+// returned, or an empty one if none was found.
+deque<Move> nestedMonteCarlo(int level, int maxLength, int numThreads);
+
+#endif
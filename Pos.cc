@@ -28,3 +28,16 @@ using namespace std;
 ostream& operator<<(ostream& out, const Pos& pos) {
     return out << '(' << char(pos.x() + 'A') << pos.y() << ')';
 }
+
+istream& operator>>(istream& in, Pos& pos) {
+    char open, column, close;
+    int y;
+    if (in >> open >> column >> y >> close) {
+	if (open != '(' || close != ')'
+	    || column < 'A' || column >= 'A' + XSIZE || y < 0 || y >= YSIZE)
+	    in.setstate(ios::failbit);
+	else
+	    pos = Pos(column - 'A', y);
+    }
+    return in;
+}
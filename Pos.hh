@@ -59,5 +59,6 @@ private:
 };
 
 ostream& operator<<(ostream& out, const Pos& pos);
+istream& operator>>(istream& in, Pos& pos);
 
 #endif
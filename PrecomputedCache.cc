@@ -0,0 +1,134 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include "PrecomputedCache.hh"
+
+using namespace std;
+
+// at the start of each file, so that a file that was truncated or belongs
+// to something else is not used
+struct PrecomputedHeader {
+    char magic[8];
+    uint64_t levelHash;
+    int32_t goal;
+    uint32_t size;		// of the table that follows
+    char kind[16];
+};
+
+static const char MAGIC[8] = { 'a', 't', 'o', 'm', 'i', 'x', 'p', 'c' };
+
+static string directory;	// empty while the cache is off
+// mapped files by name, so that a table is only mapped once
+static map<string, const char*> mapped;
+
+void PrecomputedCache::setDirectory(const string& newDirectory) {
+    directory = newDirectory;
+}
+
+string PrecomputedCache::fileName(uint64_t levelHash, int goal,
+				  const char* kind) {
+    ostringstream name;
+    name << directory << '/' << hex << levelHash << dec << '-';
+    if (goal == ANY_GOAL)
+	name << "any";
+    else
+	name << goal;
+    name << '-' << kind;
+    return name.str();
+}
+
+const void* PrecomputedCache::find(uint64_t levelHash, int goal,
+				   const char* kind, size_t size) {
+    if (directory.empty())
+	return NULL;
+    string name = fileName(levelHash, goal, kind);
+    map<string, const char*>::const_iterator m = mapped.find(name);
+    if (m != mapped.end())
+	return m->second + sizeof(PrecomputedHeader);
+
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0)
+	return NULL;
+    size_t fileSize = sizeof(PrecomputedHeader) + size;
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) == fileSize)
+	p = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+	return NULL;
+
+    const PrecomputedHeader* header = static_cast<const PrecomputedHeader*>(p);
+    if (memcmp(header->magic, MAGIC, sizeof MAGIC) != 0
+	|| header->levelHash != levelHash || header->goal != goal
+	|| header->size != size
+	|| strncmp(header->kind, kind, sizeof header->kind) != 0) {
+	munmap(p, fileSize);
+	return NULL;
+    }
+    mapped[name] = static_cast<const char*>(p);
+    return static_cast<const char*>(p) + sizeof(PrecomputedHeader);
+}
+
+const void* PrecomputedCache::store(uint64_t levelHash, int goal,
+				    const char* kind, const void* data,
+				    size_t size) {
+    if (directory.empty())
+	return NULL;
+    mkdir(directory.c_str(), 0777);
+    string name = fileName(levelHash, goal, kind);
+    ostringstream tmpName;
+    tmpName << name << ".tmp." << getpid();
+
+    PrecomputedHeader header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, MAGIC, sizeof MAGIC);
+    header.levelHash = levelHash;
+    header.goal = goal;
+    header.size = size;
+    strncpy(header.kind, kind, sizeof header.kind - 1);
+
+    int fd = open(tmpName.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    bool ok = fd >= 0
+	&& write(fd, &header, sizeof header) == ssize_t(sizeof header)
+	&& write(fd, data, size) == ssize_t(size);
+    if (fd >= 0 && close(fd) != 0)
+	ok = false;
+    if (!ok || rename(tmpName.str().c_str(), name.c_str()) != 0) {
+	cerr << "Warning: cannot store " << name << ": " << strerror(errno)
+	     << endl;
+	unlink(tmpName.str().c_str());
+	return NULL;
+    }
+    return find(levelHash, goal, kind, size);
+}
@@ -0,0 +1,64 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+
+#ifndef PRECOMPUTEDCACHE_HH
+#define PRECOMPUTEDCACHE_HH
+
+#include "stdint.h"
+
+#include <stddef.h>
+
+#include <string>
+
+// Tables computed from a level before the search, kept in files so that
+// other processes working on the same level, like the jobs of
+// atomixer-batch or the workers of a distributed search, need not compute
+// them again. A table is identified by the hash of the level, the goal
+// offset (the field number of Level::goalPos(), or ANY_GOAL if the table
+// does not depend on the goal) and its kind; change the name of the kind
+// whenever what is stored for it changes. The files are mapped read-only
+// and shared, so the page cache holds one copy for all processes, and
+// they are replaced atomically, so several processes may store the same
+// table at once.
+class PrecomputedCache {
+public:
+    static const int ANY_GOAL = -1;
+
+    // Keep the files in directory, which is created when needed. The
+    // cache is off until this is called, or after it is called with an
+    // empty name.
+    static void setDirectory(const std::string& directory);
+
+    // Return the table if it was stored before with the same size, or NULL.
+    static const void* find(uint64_t levelHash, int goal, const char* kind,
+			    size_t size);
+    // Store a table and return it like find() would. Returns NULL, after a
+    // warning, if it cannot be written; the caller then keeps its own copy.
+    static const void* store(uint64_t levelHash, int goal, const char* kind,
+			     const void* data, size_t size);
+
+private:
+    static std::string fileName(uint64_t levelHash, int goal,
+				const char* kind);
+};
+
+#endif
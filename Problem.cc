@@ -20,17 +20,22 @@
 */
 
 #include <assert.h>
+#include <string.h>
 
+#include <algorithm>
 #include <iostream>
 #include <queue>
 #include <set>
 
 #include "Dir.hh"
 #include "Level.hh"
+#include "PrecomputedCache.hh"
 #include "Problem.hh"
 
 using namespace std;
 
+uint64_t Problem::myLevelHash;
+int Problem::myGoalOffset;
 bool Problem::myIsBlock[NUM_FIELDS];
 Pos Problem::myStartPositions[NUM_ATOMS];
 Pos Problem::myGoalPositions[NUM_ATOMS];
@@ -38,6 +43,9 @@ int Problem::myNumIdentical[NUM_ATOMS];
 int Problem::myFirstIdentical[NUM_ATOMS];
 int Problem::goalDists[NUM_ATOMS][NUM_FIELDS];
 int Problem::rgoalDists[NUM_ATOMS][NUM_FIELDS];
+uint8_t Problem::goalDistBytes[NUM_ATOMS][NUM_FIELDS];
+uint8_t Problem::rgoalDistBytes[NUM_ATOMS][NUM_FIELDS];
+uint64_t Problem::zobristKeys[NUM_ATOMS][NUM_FIELDS];
 int Problem::goalNr;
 Atom Problem::atoms[NUM_ATOMS];
 #ifdef DO_REVERSE_SEARCH
@@ -48,6 +56,7 @@ void Problem::setLevel(const Level& level) {
     typedef multimap<Atom, Pos> AtomMap;
     AtomMap startAtoms;
     int numFields = 0;
+    myLevelHash = level.hash();
 
     for (Pos pos = 0; pos != Pos::end(); ++pos) {
 	const Atom& atom = level.startBoard().field(pos);
@@ -102,6 +111,27 @@ void Problem::setLevel(const Level& level) {
     }
     cout << "unique: " << numUnique << "; paired: " << numPaired
 	 << "; multi: " << numMulti << endl;
+
+    // splitmix64, with a fixed seed so that runs are reproducible
+    uint64_t seed = 0;
+    for (int i = 0; i < NUM_ATOMS; ++i) {
+	// the first atom of each kind
+	int first = i;
+	if (i >= PAIRED_START && i < PAIRED_END)
+	    first = i - (i - PAIRED_START) % 2;
+	else if (i >= MULTI_START)
+	    first = myFirstIdentical[i];
+	for (int field = 0; field < NUM_FIELDS; ++field) {
+	    if (first != i) {
+		zobristKeys[i][field] = zobristKeys[first][field];
+		continue;
+	    }
+	    uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+	    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	    zobristKeys[i][field] = z ^ (z >> 31);
+	}
+    }
     cout << "Fields: " << numFields << endl;
     assert(numUnique == NUM_UNIQUE);
     assert(numPaired == NUM_PAIRED);
@@ -111,6 +141,7 @@ void Problem::setLevel(const Level& level) {
 void Problem::setGoal(const Level& level, int goalPosNr) {
     goalNr = goalPosNr;
     Pos d = level.goalPos(goalPosNr);
+    myGoalOffset = d.fieldNumber();
     int dx = d.x(), dy = d.y();
     typedef multimap<Atom, Pos> AtomMap;
     AtomMap goalAtoms;
@@ -150,9 +181,34 @@ void Problem::setGoal(const Level& level, int goalPosNr) {
 	cout << endl;
     }
 
+    // The search reads its own copies, which need no indirection. The
+    // distances to the start are the same for all goals.
+    const void* dists = PrecomputedCache::find(
+	myLevelHash, myGoalOffset, "goaldists", sizeof goalDists);
+    if (dists != NULL) {
+	memcpy(goalDists, dists, sizeof goalDists);
+    } else {
+	for (int i = 0; i < NUM_ATOMS; ++i)
+	    calcDists(goalDists[i], myGoalPositions[i]);
+	PrecomputedCache::store(myLevelHash, myGoalOffset, "goaldists",
+				goalDists, sizeof goalDists);
+    }
+    const void* rdists = PrecomputedCache::find(
+	myLevelHash, PrecomputedCache::ANY_GOAL, "rgoaldists",
+	sizeof rgoalDists);
+    if (rdists != NULL) {
+	memcpy(rgoalDists, rdists, sizeof rgoalDists);
+    } else {
+	for (int i = 0; i < NUM_ATOMS; ++i)
+	    calcDists(rgoalDists[i], myStartPositions[i]);
+	PrecomputedCache::store(myLevelHash, PrecomputedCache::ANY_GOAL,
+				"rgoaldists", rgoalDists, sizeof rgoalDists);
+    }
     for (int i = 0; i < NUM_ATOMS; ++i) {
-	calcDists(goalDists[i], myGoalPositions[i]);
-	calcDists(rgoalDists[i], myStartPositions[i]);
+	for (int field = 0; field < NUM_FIELDS; ++field) {
+	    goalDistBytes[i][field] = min(goalDists[i][field], 255);
+	    rgoalDistBytes[i][field] = min(rgoalDists[i][field], 255);
+	}
     }
 #ifdef DO_REVERSE_SEARCH
     calcCloseStates();
@@ -25,6 +25,8 @@
 class Level;
 class Board;
 
+#include "stdint.h"
+
 #include "Atom.hh"
 #include "Pos.hh"
 #include "Size.hh"
@@ -59,8 +61,32 @@ public:
     static int rgoalDist(int atomNr, Pos pos) {
 	return rgoalDists[atomNr][pos.fieldNumber()];
     }
+    // the same in bytes, with 255 for anything farther, so that the tables
+    // of all atoms stay in the L1 cache
+    static int goalDistByte(int atomNr, Pos pos) {
+	return goalDistBytes[atomNr][pos.fieldNumber()];
+    }
+    static int rgoalDistByte(int atomNr, Pos pos) {
+	return rgoalDistBytes[atomNr][pos.fieldNumber()];
+    }
+
+    // Zobrist keys: a random number for each kind of atom and field. The
+    // xor over all atoms is a hash of the state that can be updated with
+    // each move, and doesn't tell identical atoms apart.
+    static uint64_t zobristKey(int atomNr, Pos pos) {
+	return zobristKeys[atomNr][pos.fieldNumber()];
+    }
 
     static Atom atom(int nr) { return atoms[nr]; }
+
+    // what PrecomputedCache files of the current level and goal are
+    // identified by
+    static uint64_t levelHash() { return myLevelHash; }
+    static int goalOffset() { return myGoalOffset; }
+
+    // store in dists[p] the minimum number of moves for a single atom from p
+    // to goal, on an otherwise empty board
+    static void calcDists(int dists[NUM_FIELDS], Pos goal);
 #ifdef DO_REVERSE_SEARCH
     static const HashTable<RevState>& revStates() { return _revStates; }
 #endif
@@ -68,11 +94,12 @@ public:
     static int goalNr;
 
 private:
-    static void calcDists(int dists[NUM_FIELDS], Pos goal);
 #ifdef DO_REVERSE_SEARCH
     static void calcCloseStates();
 #endif
 
+    static uint64_t myLevelHash;
+    static int myGoalOffset;
     static bool myIsBlock[NUM_FIELDS];
     static Pos myStartPositions[NUM_ATOMS];
     static Pos myGoalPositions[NUM_ATOMS];
@@ -80,6 +107,9 @@ private:
     static int myFirstIdentical[NUM_ATOMS];
     static int goalDists[NUM_ATOMS][NUM_FIELDS];
     static int rgoalDists[NUM_ATOMS][NUM_FIELDS];
+    static uint8_t goalDistBytes[NUM_ATOMS][NUM_FIELDS];
+    static uint8_t rgoalDistBytes[NUM_ATOMS][NUM_FIELDS];
+    static uint64_t zobristKeys[NUM_ATOMS][NUM_FIELDS];
     static Atom atoms[NUM_ATOMS];
 #ifdef DO_REVERSE_SEARCH
     static HashTable<RevState> _revStates;
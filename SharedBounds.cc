@@ -0,0 +1,51 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#include <sys/mman.h>
+
+#include <stdexcept>
+
+#include "SharedBounds.hh"
+
+using namespace std;
+
+void SharedBounds::raiseLowerBound(int bound) {
+    int old;
+    while ((old = lowerBound) < bound
+	   && !__sync_bool_compare_and_swap(&lowerBound, old, bound)) { }
+}
+
+void SharedBounds::lowerUpperBound(int bound) {
+    int old;
+    while ((old = upperBound) > bound
+	   && !__sync_bool_compare_and_swap(&upperBound, old, bound)) { }
+}
+
+SharedBounds* SharedBounds::create(int lowerBound, int upperBound) {
+    void* p = mmap(NULL, sizeof(SharedBounds), PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+	throw runtime_error("cannot map shared bounds");
+    SharedBounds* bounds = static_cast<SharedBounds*>(p);
+    bounds->lowerBound = lowerBound;
+    bounds->upperBound = upperBound;
+    return bounds;
+}
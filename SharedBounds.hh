@@ -0,0 +1,41 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#ifndef SHAREDBOUNDS_HH
+#define SHAREDBOUNDS_HH
+
+// Bounds on the solution length of the level being solved, shared by all
+// searches working on it, possibly in different processes. Lower bounds
+// only rise and upper bounds only fall. When they meet, the best known
+// solution is optimal and all searches can stop.
+struct SharedBounds {
+    volatile int lowerBound;	// no solution is shorter
+    volatile int upperBound;	// length of the best solution known
+
+    bool solved() const { return lowerBound >= upperBound; }
+    void raiseLowerBound(int bound);
+    void lowerUpperBound(int bound);
+
+    // Allocate in memory that stays shared with processes forked later.
+    static SharedBounds* create(int lowerBound, int upperBound);
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#include <iostream>
+#include <vector>
+
+#include "MovePruning.hh"
+#include "Problem.hh"
+#include "Shortener.hh"
+#include "State.hh"
+#include "Statistics.hh"
+
+using namespace std;
+
+// the state to reach and, for each atom, its distance to its position there
+static State target;
+static int targetDists[NUM_ATOMS][NUM_FIELDS];
+static vector<Move> path;
+
+static void setTarget(const State& state) {
+    target = state;
+    for (int i = 0; i < NUM_ATOMS; ++i)
+	Problem::calcDists(targetDists[i], Pos(state.atomPosition(i)));
+}
+
+static int minMovesLeft(const State& state) {
+    int minMovesLeft = 0;
+    for (int i = 0; i < NUM_ATOMS; ++i)
+	minMovesLeft
+	    += targetDists[i][Pos(state.atomPosition(i)).fieldNumber()];
+    return minMovesLeft;
+}
+
+// search for target from state with path[0..depth) done; return whether it
+// was reached in at most maxDepth moves
+static bool dfs(const State& state, int depth, int maxDepth) {
+    if (state == target)
+	return true;
+    ++Statistics::statesExpanded;
+    vector<Move> moves = state.moves();
+    for (vector<Move>::const_iterator m = moves.begin(); m != moves.end(); ++m) {
+	if (MovePruning::isPruned<false>(&path[0], depth, *m))
+	    continue;
+	++Statistics::statesGenerated;
+	State child(state, *m);
+	if (depth + 1 + minMovesLeft(child) > maxDepth)
+	    continue;
+	path[depth] = *m;
+	if (dfs(child, depth + 1, maxDepth))
+	    return true;
+    }
+    return false;
+}
+
+// return the length of the shortest path from start to target if it is at
+// most maxDepth, leaving it in path, otherwise -1
+static int shortestPath(const State& start, int maxDepth) {
+    path.resize(maxDepth + 1);
+    for (int depth = minMovesLeft(start); depth <= maxDepth; ++depth)
+	if (dfs(start, 0, depth))
+	    return depth;
+    return -1;
+}
+
+deque<Move> shortenSolution(const deque<Move>& solution, int window) {
+    State start(Problem::startPositions());
+    MovePruning::learn(start, false);
+    Statistics::timer.start();
+
+    vector<Move> moves(solution.begin(), solution.end());
+    State state(start);
+    size_t i = 0;
+    while (i + 1 < moves.size()) {
+	size_t j = min(i + window, moves.size());
+	State end(state);
+	for (size_t k = i; k < j; ++k)
+	    end.apply(moves[k]);
+	setTarget(end);
+	int length = shortestPath(state, j - i - 1);
+	if (length >= 0) {
+	    cout << "Moves " << i << ".." << j << ": " << j - i << " -> "
+		 << length << ", solution now " << moves.size() - (j - i) + length
+		 << " moves" << endl;
+	    moves.erase(moves.begin() + i, moves.begin() + j);
+	    moves.insert(moves.begin() + i, path.begin(),
+			 path.begin() + length);
+	    // try the changed window again
+	    continue;
+	}
+	state.apply(moves[i]);
+	++i;
+    }
+
+    Statistics::timer.stop();
+    return deque<Move>(moves.begin(), moves.end());
+}
@@ -0,0 +1,36 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#ifndef SHORTENER_HH
+#define SHORTENER_HH
+
+#include <deque>
+
+#include "Move.hh"
+
+// Shorten solution, a move sequence from Problem::startPositions(), by
+// local re-search: for each pair of states window moves apart on it, IDA*
+// looks for a shorter path between them, which is then spliced in. Only
+// exact states are matched, so identical atoms are not swapped. The result
+// is a solution no window of which can be shortened.
+deque<Move> shortenSolution(const deque<Move>& solution, int window);
+
+#endif
@@ -0,0 +1,176 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#include <limits.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "IDAStarState.hh"
+#include "Level.hh"
+#include "MovePruning.hh"
+#include "Problem.hh"
+#include "SharedBounds.hh"
+#include "Statistics.hh"
+#include "WIDAStar.hh"
+
+using namespace std;
+
+// f-values are kept as integers, with the weight in units of 1/WEIGHT_SCALE
+static const int WEIGHT_SCALE = 100;
+
+// nothing is searched beyond this many moves if no solution is known
+static const int MAX_LENGTH = 127;
+
+static IDAStarState state;
+static int weight;
+static int threshold, nextThreshold;
+static int maxLength;		// of solutions still worth finding
+static vector<Move> path;
+static deque<Move>* solution;
+static bool found;
+static SharedBounds* bounds;
+static bool aborted;
+
+static inline int weightedF() {
+    return WEIGHT_SCALE * state.moves() + weight * state.minMovesLeft();
+}
+
+static void dfs() {
+    if ((++Statistics::statesExpanded & 0xffff) == 0) {
+	// maybe somebody else found a better solution
+	if (bounds->upperBound - 1 < maxLength)
+	    maxLength = bounds->upperBound - 1;
+	if (bounds->lowerBound > maxLength)
+	    aborted = true;
+    }
+    if (aborted)
+	return;
+
+    for (int atomNr = 0; atomNr < NUM_ATOMS; ++atomNr) {
+	Pos startPos = state.atomPosition(atomNr);
+	for (int dirNo = 0; dirNo < 4; ++dirNo) {
+	    Dir dir = DIRS[dirNo];
+	    Pos pos;
+	    for (pos = startPos + dir; !state.isBlocking(pos); pos += dir) { }
+	    Pos newPos = pos - dir;
+	    if (newPos == startPos)
+		continue;
+	    Move move(atomNr, startPos, newPos, dir);
+	    ++Statistics::numChildren;
+	    if (MovePruning::isPruned<false>(&path[0], state.moves(), move)) {
+		++Statistics::numPruned;
+		continue;
+	    }
+
+	    int oldMinMovesLeft = state.minMovesLeft();
+	    state.apply(move);
+	    ++Statistics::statesGenerated;
+	    path[state.moves() - 1] = move;
+	    if (state.minMovesLeft() == 0) {
+		solution->assign(path.begin(), path.begin() + state.moves());
+		maxLength = state.moves() - 1;
+		found = true;
+		cout << "Found solution in " << state.moves() << " moves after "
+		     << Statistics::timer << endl;
+	    } else if (state.minTotalMoves() <= maxLength) {
+		if (weightedF() > threshold) {
+		    if (weightedF() < nextThreshold)
+			nextThreshold = weightedF();
+		} else {
+		    dfs();
+		}
+	    }
+	    state.undo(move, oldMinMovesLeft);
+	}
+    }
+}
+
+int WIDAStar(const Level& level, double w, SharedBounds* sharedBounds,
+	     deque<Move>& bestSolution) {
+    weight = int(w * WEIGHT_SCALE + 0.5);
+    solution = &bestSolution;
+    bounds = sharedBounds;
+    maxLength = bestSolution.empty()
+	? MAX_LENGTH : int(bestSolution.size()) - 1;
+    if (bounds->upperBound - 1 < maxLength)
+	maxLength = bounds->upperBound - 1;
+    if (bounds->lowerBound > maxLength)
+	return -2;
+    path.resize(maxLength + 1);
+    found = false;
+    aborted = false;
+    cout << "WIDA* with weight " << w << ", looking for solutions with at most "
+	 << maxLength << " moves\n";
+
+    // the next threshold for each goal; INT_MAX if it has no short solution
+    vector<int> goalThreshold(level.numGoals());
+    for (int goalNr = 0; goalNr < level.numGoals(); ++goalNr) {
+	Problem::setGoal(level, goalNr);
+	state = IDAStarState(State(Problem::startPositions()));
+	goalThreshold[goalNr] = state.minMovesLeft() > maxLength
+	    ? INT_MAX : weightedF();
+    }
+    MovePruning::learn(state, false);
+
+    int foundGoalNr = -1;
+    Statistics::timer.start();
+    for (;;) {
+	threshold = *min_element(goalThreshold.begin(), goalThreshold.end());
+	if (threshold == INT_MAX)
+	    break;
+	for (int goalNr = 0; goalNr < level.numGoals(); ++goalNr) {
+	    if (goalThreshold[goalNr] > threshold)
+		continue;
+	    Problem::setGoal(level, goalNr);
+	    state = IDAStarState(State(Problem::startPositions()));
+	    if (state.minTotalMoves() > maxLength) {
+		goalThreshold[goalNr] = INT_MAX;
+		continue;
+	    }
+	    nextThreshold = INT_MAX;
+	    bool hadSolution = found;
+	    found = false;
+	    dfs();
+	    if (found)
+		foundGoalNr = goalNr;
+	    found = found || hadSolution;
+	    goalThreshold[goalNr] = nextThreshold;
+	    if (aborted)
+		break;
+	}
+	if (found || aborted)
+	    break;
+    }
+    Statistics::timer.stop();
+
+    if (found) {
+	Statistics::upperBound = bestSolution.size();
+	return foundGoalNr;
+    }
+    if (aborted)
+	return -2;
+    // every path within maxLength has been looked at
+    if (maxLength < MAX_LENGTH)
+	bounds->raiseLowerBound(maxLength + 1);
+    return -1;
+}
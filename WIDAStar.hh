@@ -0,0 +1,45 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+#ifndef WIDASTAR_HH
+#define WIDASTAR_HH
+
+#include <deque>
+
+#include "Move.hh"
+
+class Level;
+struct SharedBounds;
+
+// Weighted IDA* [Kor93]: iterative deepening on f = g + weight * h, which
+// finds solutions quickly but not necessarily optimal ones. All goals of
+// level are searched with the same threshold, so that goals without a short
+// solution don't hold up the others. Only solutions shorter than both
+// solution (if not empty) and bounds->upperBound are looked for; the
+// iteration that finds the first one is searched to the end, keeping the
+// shortest. Returns the goal number of the new solution. Otherwise,
+// returns -1 if it was proven that there is no such solution, in which
+// case bounds->lowerBound is raised, or -2 if bounds->lowerBound rose so
+// far that there is nothing left to find.
+int WIDAStar(const Level& level, double weight, SharedBounds* bounds,
+	     deque<Move>& solution);
+
+#endif
@@ -0,0 +1,553 @@
+/*
+  atomixer -- Atomix puzzle solver
+  Copyright (C) 2000 Falk Hueffner
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+  
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+  
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+  Place, Suite 330, Boston, MA 02111-1307 USA
+
+  $Id$
+*/
+
+// atomixer-batch: solve many levels with several solver processes at once.
+//
+// The solver is compiled for each level, so every level gets its own build
+// directory below the work directory, into which the sources are copied
+// when they changed. Jobs are started as long as there are free slots and
+// their memory fits into the total budget, in order of how hard the bounds
+// database predicts them to be. Each solver gets --memory of its share and
+// writes its results into the shared bounds database itself, and shares the
+// tables computed from the levels through precomputed/ in the work
+// directory. The CPU limit is an rlimit, the wall-clock limit a timer here;
+// in both cases the solver first gets a signal to write a checkpoint, and
+// is killed GRACE seconds later. A level with a checkpoint is resumed.
+// The jobs run in process groups of their own, so that the solver and
+// everything make starts can be signalled at once, and a Ctrl-C in the
+// terminal does not reach them; SIGINT, SIGTERM and SIGHUP are passed on
+// here the same way, and a second one kills the jobs right away.
+
+#include "stdint.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "LargeMemory.hh"
+#include "parameters.hh"
+
+using namespace std;
+
+// seconds between asking a solver to stop and killing it
+static const int GRACE = 30;
+
+struct Job {
+    string level;		// level file as given
+    string name;		// without the directories
+    string dir;			// where it is built and run
+
+    // from the bounds database; goals without an entry are not counted, so
+    // the lower bound is only a guess, which is good enough for ordering
+    int lowerBound, upperBound;	// 0 if unknown
+
+    enum { WAITING, BUILDING, SOLVING, DONE } phase;
+    pid_t pid;
+    double started;		// when solving began
+    bool stopping;		// asked to stop
+    double killAt;		// when to kill it if it is stopping
+};
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static string isotime() {
+    time_t timet = time(NULL);
+    char timestr[256];
+    strftime(timestr, sizeof(timestr), "%Y-%m-%d %H:%M:%S",
+	     localtime(&timet));
+    return string(timestr);
+}
+
+static string baseName(const string& path) {
+    size_t slash = path.rfind('/');
+    return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+static bool readFile(const string& fileName, string& contents) {
+    ifstream in(fileName.c_str());
+    if (!in)
+	return false;
+    ostringstream s;
+    s << in.rdbuf();
+    contents = s.str();
+    return true;
+}
+
+// write contents to fileName unless it has them already, so that make only
+// rebuilds what changed
+static void updateFile(const string& fileName, const string& contents) {
+    string old;
+    if (readFile(fileName, old) && old == contents)
+	return;
+    ofstream out(fileName.c_str());
+    out << contents;
+    if (!out)
+	throw runtime_error("cannot write " + fileName);
+}
+
+// (lower bound, solution length) of each level in the bounds database,
+// whose format is described in BoundsDatabase.cc
+static void readBounds(const string& fileName, vector<Job>& jobs) {
+    for (size_t i = 0; i < jobs.size(); ++i)
+	jobs[i].lowerBound = jobs[i].upperBound = 0;
+    ifstream in(fileName.c_str());
+    string line;
+    while (getline(in, line)) {
+	istringstream lineStream(line);
+	string hash, name, goalPos;
+	int lowerBound, length;
+	double seconds;
+	uint64_t states;
+	if (!(lineStream >> hash >> name >> goalPos >> lowerBound >> seconds
+	      >> states >> length))
+	    continue;
+	for (size_t i = 0; i < jobs.size(); ++i) {
+	    Job& job = jobs[i];
+	    if (job.name != name)
+		continue;
+	    if (job.lowerBound == 0 || lowerBound < job.lowerBound)
+		job.lowerBound = lowerBound;
+	    if (length > 0 && (job.upperBound == 0 || length < job.upperBound))
+		job.upperBound = length;
+	}
+    }
+}
+
+// levels with short solutions first
+static bool byBound(const Job& j1, const Job& j2) {
+    int b1 = j1.upperBound != 0 ? j1.upperBound : j1.lowerBound;
+    int b2 = j2.upperBound != 0 ? j2.upperBound : j2.lowerBound;
+    return b1 < b2;
+}
+
+// levels that are closest to being solved first
+static bool byGap(const Job& j1, const Job& j2) {
+    int g1 = j1.upperBound != 0 ? j1.upperBound - j1.lowerBound : INT_MAX;
+    int g2 = j2.upperBound != 0 ? j2.upperBound - j2.lowerBound : INT_MAX;
+    if (g1 != g2)
+	return g1 < g2;
+    return j1.lowerBound < j2.lowerBound;
+}
+
+// Copy the sources into the job's directory and generate its Size.hh,
+// like run.sh does.
+static void prepare(const Job& job) {
+    mkdir(job.dir.c_str(), 0777);
+    DIR* d = opendir(".");
+    if (d == NULL)
+	throw runtime_error("cannot read the source directory");
+    while (struct dirent* e = readdir(d)) {
+	string name = e->d_name;
+	size_t dot = name.rfind('.');
+	string suffix = dot == string::npos ? "" : name.substr(dot);
+	if ((suffix == ".cc" || suffix == ".hh" || name == "Makefile")
+	    && name != "Size.hh") {
+	    string contents;
+	    if (readFile(name, contents))
+		updateFile(job.dir + "/" + name, contents);
+	}
+    }
+    closedir(d);
+
+    string command = "awk -f countatoms.awk < '" + job.level + "'";
+    FILE* p = popen(command.c_str(), "r");
+    char buf[256];
+    string counts;
+    while (p != NULL && fgets(buf, sizeof buf, p) != NULL)
+	counts += buf;
+    if (p == NULL || pclose(p) != 0)
+	throw runtime_error("cannot count the atoms of " + job.level);
+
+    static const char* const fields[] = {
+	"@xsize@", "@ysize@", "@large_board@", "@unique@", "@paired@",
+	"@multi@"
+    };
+    string size;
+    if (!readFile("Size.hh.in", size))
+	throw runtime_error("cannot read Size.hh.in");
+    istringstream in(counts);
+    for (int i = 0; i < 6; ++i) {
+	string value;
+	in >> value;
+	size_t at = size.find(fields[i]);
+	if (at != string::npos)
+	    size.replace(at, strlen(fields[i]), value);
+    }
+    updateFile(job.dir + "/Size.hh", size);
+}
+
+// run argv in dir with output appended to logFile; returns the pid
+static pid_t spawn(const string& dir, const string& logFile,
+		   const vector<string>& args, rlim_t cpuLimit) {
+    pid_t pid = fork();
+    if (pid < 0)
+	throw runtime_error("cannot fork");
+    if (pid > 0)
+	return pid;
+
+    // a group of its own, so that its helper processes get the signals too
+    setpgid(0, 0);
+    sigset_t all;
+    sigfillset(&all);
+    sigprocmask(SIG_UNBLOCK, &all, NULL);
+    if (chdir(dir.c_str()) != 0)
+	_exit(127);
+    int fd = open(logFile.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0666);
+    if (fd < 0)
+	_exit(127);
+    dup2(fd, 1);
+    dup2(fd, 2);
+    close(fd);
+    if (cpuLimit != 0) {
+	// SIGXCPU at the soft limit, SIGKILL at the hard one
+	struct rlimit limit;
+	limit.rlim_cur = cpuLimit;
+	limit.rlim_max = cpuLimit + GRACE;
+	setrlimit(RLIMIT_CPU, &limit);
+    }
+    vector<char*> argv;
+    for (size_t i = 0; i < args.size(); ++i)
+	argv.push_back(const_cast<char*>(args[i].c_str()));
+    argv.push_back(NULL);
+    execvp(argv[0], &argv[0]);
+    _exit(127);
+}
+
+static void noop(int) { }
+
+// ask a job to stop; it is killed if it is still there after GRACE seconds
+static void stop(Job& job) {
+    kill(-job.pid, SIGTERM);
+    job.stopping = true;
+    job.killAt = now() + GRACE;
+}
+
+static void usage() {
+    cout << "Usage: atomixer-batch [options] [levelfiles]" << endl
+	 << "Solves the levels given, or listed one per line on standard input,"
+	 << endl
+	 << "with several solvers at once. Run it in the source directory."
+	 << endl
+	 << "Options:" << endl
+	 << "  --jobs n       solvers to run at once (default: number of CPUs)"
+	 << endl
+	 << "  --memory size  for all solvers together, like 12G (default: "
+	 << int(MEMORY_FRACTION * 100) << "%" << endl
+	 << "                 of what is available)" << endl
+	 << "  --job-memory size  for each solver (default: --memory / --jobs)"
+	 << endl
+	 << "  --cpu seconds  CPU time limit of each solver" << endl
+	 << "  --time seconds  wall-clock limit of each solver" << endl
+	 << "  --order bound  levels with the shortest known solution or"
+	 << endl
+	 << "                 lower bound first (default)" << endl
+	 << "  --order gap    levels with the smallest gap between the bounds"
+	 << endl
+	 << "                 first" << endl
+	 << "  --bounds file  bounds database to use (default: bounds.db)"
+	 << endl
+	 << "  --dir dir      work directory (default: batch)" << endl
+	 << "  --args string  more options for the solver" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+    int numJobs = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t memory = 0, jobMemory = 0;
+    rlim_t cpuLimit = 0;
+    double timeLimit = 0;
+    string order = "bound";
+    string boundsFile = "bounds.db";
+    string workDir = "batch";
+    vector<string> solverArgs;
+
+    int argNr;
+    for (argNr = 1; argNr < argc && argv[argNr][0] == '-'; ++argNr) {
+	string option = argv[argNr];
+	bool ok = argNr + 1 < argc;
+	if (!ok) {
+	} else if (option == "--jobs") {
+	    numJobs = atoi(argv[++argNr]);
+	    ok = numJobs > 0;
+	} else if (option == "--memory") {
+	    memory = LargeMemory::parseSize(argv[++argNr]);
+	    ok = memory != 0;
+	} else if (option == "--job-memory") {
+	    jobMemory = LargeMemory::parseSize(argv[++argNr]);
+	    ok = jobMemory != 0;
+	} else if (option == "--cpu") {
+	    cpuLimit = atoi(argv[++argNr]);
+	    ok = cpuLimit > 0;
+	} else if (option == "--time") {
+	    timeLimit = atof(argv[++argNr]);
+	    ok = timeLimit > 0;
+	} else if (option == "--order") {
+	    order = argv[++argNr];
+	    ok = order == "bound" || order == "gap";
+	} else if (option == "--bounds") {
+	    boundsFile = argv[++argNr];
+	} else if (option == "--dir") {
+	    workDir = argv[++argNr];
+	} else if (option == "--args") {
+	    istringstream in(argv[++argNr]);
+	    string arg;
+	    while (in >> arg)
+		solverArgs.push_back(arg);
+	} else {
+	    ok = false;
+	}
+	if (!ok) {
+	    usage();
+	    return 1;
+	}
+    }
+
+    // the solvers run in other directories
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof cwd) == NULL)
+	throw runtime_error("cannot get the current directory");
+    if (boundsFile[0] != '/')
+	boundsFile = string(cwd) + "/" + boundsFile;
+    if (workDir[0] != '/')
+	workDir = string(cwd) + "/" + workDir;
+    mkdir(workDir.c_str(), 0777);
+
+    vector<Job> jobs;
+    vector<string> levels(argv + argNr, argv + argc);
+    if (levels.empty()) {
+	string level;
+	while (getline(cin, level))
+	    if (!level.empty())
+		levels.push_back(level);
+    }
+    for (size_t i = 0; i < levels.size(); ++i) {
+	Job job;
+	job.level = levels[i];
+	if (job.level[0] != '/')
+	    job.level = string(cwd) + "/" + job.level;
+	job.name = baseName(levels[i]);
+	// the bounds database couldn't hold the name
+	if (job.name.find_first_of(" \t\n\r\v\f") != string::npos) {
+	    cerr << "Level name \"" << job.name << "\" contains white space"
+		 << endl;
+	    return 1;
+	}
+	job.dir = workDir + "/" + job.name;
+	job.phase = Job::WAITING;
+	job.pid = 0;
+	job.started = 0;
+	job.stopping = false;
+	job.killAt = 0;
+	jobs.push_back(job);
+    }
+    readBounds(boundsFile, jobs);
+    stable_sort(jobs.begin(), jobs.end(), order == "gap" ? byGap : byBound);
+
+    if (memory == 0)
+	memory = LargeMemory::budget();
+    if (jobMemory == 0)
+	jobMemory = memory / numJobs;
+    if (jobMemory > memory) {
+	cerr << "--job-memory is more than --memory" << endl;
+	return 1;
+    }
+    ostringstream jobMemoryArg;
+    jobMemoryArg << jobMemory / 1024 << "K";
+
+    ostringstream logName;
+    logName << "batch." << getpid() << ".log";
+    ofstream log(logName.str().c_str());
+    cout << "Solving " << jobs.size() << " levels, " << numJobs
+	 << " at a time with " << jobMemory / (1024 * 1024) << " MB each"
+	 << endl;
+
+    // SIGCHLD and the termination signals only arrive in sigtimedwait()
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    signal(SIGCHLD, noop);
+
+    int quitSignal = 0;		// the termination signal we got, if any
+    int running = 0;
+    size_t next = 0;		// first job that may still be waiting
+    while (next < jobs.size() || running > 0) {
+	// start as many as fit
+	while (next < jobs.size() && running < numJobs
+	       && (running + 1) * jobMemory <= memory) {
+	    Job& job = jobs[next++];
+	    cout << job.name << ": building" << endl;
+	    log << job.name << ": started on " << isotime() << endl;
+	    prepare(job);
+	    vector<string> args;
+	    args.push_back("make");
+	    args.push_back("atomixer");
+	    job.pid = spawn(job.dir, "make.log", args, 0);
+	    job.phase = Job::BUILDING;
+	    ++running;
+	}
+
+	int status;
+	struct rusage usage;
+	pid_t pid;
+	while ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0) {
+	    size_t j;
+	    for (j = 0; j < jobs.size() && jobs[j].pid != pid; ++j) { }
+	    if (j == jobs.size())
+		continue;
+	    Job& job = jobs[j];
+	    if (job.phase == Job::BUILDING && quitSignal == 0
+		&& WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+		vector<string> args;
+		args.push_back("./atomixer");
+		args.push_back("--memory");
+		args.push_back(jobMemoryArg.str());
+		args.push_back("--bounds");
+		args.push_back(boundsFile);
+		args.push_back("--precomputed");
+		args.push_back(workDir + "/precomputed");
+		if (access((job.dir + "/" + job.name + ".checkpoint").c_str(),
+			   F_OK) == 0)
+		    args.push_back("--resume");
+		args.insert(args.end(), solverArgs.begin(), solverArgs.end());
+		args.push_back(job.level);
+		cout << job.name << ": solving" << endl;
+		job.pid = spawn(job.dir, job.name + ".log", args, cpuLimit);
+		job.phase = Job::SOLVING;
+		job.started = now();
+		continue;
+	    }
+
+	    ostringstream result;
+	    if (job.phase == Job::BUILDING && job.stopping)
+		result << "build stopped";
+	    else if (job.phase == Job::BUILDING)
+		result << "build failed, see " << job.dir << "/make.log";
+	    else if (WIFSIGNALED(status))
+		result << "killed by signal " << WTERMSIG(status);
+	    else
+		result << "exit code " << WEXITSTATUS(status);
+	    if (job.phase == Job::SOLVING) {
+		vector<Job> one(1, job);
+		readBounds(boundsFile, one);
+		result << ", " << usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+		       << " s CPU, " << int(now() - job.started)
+		       << " s; bounds now " << one[0].lowerBound << ".."
+		       << one[0].upperBound;
+	    }
+	    cout << job.name << ": " << result.str() << endl;
+	    log << job.name << ": finished on " << isotime() << ", "
+		<< result.str() << endl;
+	    job.phase = Job::DONE;
+	    job.pid = 0;
+	    --running;
+	}
+
+	// enforce the wall-clock limit and the grace period, and sleep until
+	// the next one is due, a child exits, or we are told to quit
+	double wait = -1;
+	for (size_t j = 0; j < jobs.size(); ++j) {
+	    Job& job = jobs[j];
+	    double left;
+	    if (job.stopping) {
+		if (job.phase == Job::DONE)
+		    continue;
+		left = job.killAt - now();
+		if (left <= 0) {
+		    kill(-job.pid, SIGKILL);
+		    job.killAt = now() + GRACE;
+		    left = GRACE;
+		}
+	    } else {
+		if (job.phase != Job::SOLVING || timeLimit <= 0)
+		    continue;
+		left = job.started + timeLimit - now();
+		if (left <= 0) {
+		    cout << job.name << ": out of time" << endl;
+		    stop(job);
+		    left = GRACE;
+		}
+	    }
+	    if (wait < 0 || left < wait)
+		wait = left;
+	}
+	if (running > 0) {
+	    struct timespec timeout;
+	    timeout.tv_sec = time_t(wait);
+	    timeout.tv_nsec = long((wait - timeout.tv_sec) * 1e9);
+	    int sig = sigtimedwait(&signals, NULL,
+				   wait < 0 ? NULL : &timeout);
+	    if (sig > 0 && sig != SIGCHLD) {
+		// start nothing more, and pass it on to the running jobs
+		bool again = quitSignal != 0;
+		quitSignal = sig;
+		next = jobs.size();
+		cout << "Got signal " << sig << ", "
+		     << (again ? "killing" : "stopping") << " " << running
+		     << " jobs" << endl;
+		for (size_t j = 0; j < jobs.size(); ++j) {
+		    Job& job = jobs[j];
+		    if (job.phase != Job::BUILDING && job.phase != Job::SOLVING)
+			continue;
+		    if (!job.stopping)
+			stop(job);
+		    if (again)
+			job.killAt = 0;
+		}
+	    }
+	}
+    }
+    if (quitSignal != 0) {
+	log << "stopped by signal " << quitSignal << " on " << isotime()
+	    << endl;
+	return 128 + quitSignal;
+    }
+    return 0;
+    } catch (const exception& e) {
+	cerr << "Error: " << e.what() << endl;
+	return 1;
+    }
+}
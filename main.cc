@@ -20,30 +20,71 @@
 */
 
 #include <assert.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <vector>
 
+#include "BeamSearch.hh"
+#include "BoundsDatabase.hh"
+#include "LargeMemory.hh"
 #include "Level.hh"
+#include "NestedMonteCarlo.hh"
+#include "PrecomputedCache.hh"
 #include "Problem.hh"
+#include "SharedBounds.hh"
+#include "Shortener.hh"
 #include "State.hh"
 #include "Statistics.hh"
+#include "WIDAStar.hh"
 #include "parameters.hh"
 
 #define USE_IDASTAR 1		// IDA*
-//#undef USE_IDASTAR		// A*
+//#undef USE_IDASTAR		// A*, or Fringe search with USE_FRINGE
+
+#undef USE_FRINGE
+//#define USE_FRINGE 1
 
 #ifdef USE_IDASTAR
+# include "Distributed.hh"
 # include "IDAStar.hh"
+#elif defined(USE_FRINGE)
+# include "Fringe.hh"
 #else
 # include "AStar2.hh"
+# include "HDAStar.hh"
 #endif
 
 using namespace std;
 
+static const char* DEFAULT_WEIGHTS = "5,3,2,1.5";
+// Very large weights make WIDA* practically a greedy search, but without
+// duplicate detection that tends to get lost in long paths.
+static const char* DEFAULT_PORTFOLIO_WEIGHTS = "5,2";
+
 static string levelName;
+#ifdef USE_IDASTAR
+static string algorithmName = IDAStarName();
+#else
+static string algorithmName = ALGORITHM_NAME;
+#endif
+// beam search and nested Monte-Carlo search give up on solutions longer
+// than this
+static const int MAX_HEURISTIC_LENGTH = 127;
+
+static vector<pid_t> helpers;	// processes of a portfolio run
+#ifdef USE_IDASTAR
+static string checkpointFile;
+static string checkpointHeader;	// identifies level and goal
+#endif
 
 string isotime() {
     time_t timet = time(NULL);
@@ -55,9 +96,9 @@ string isotime() {
 
 extern "C" {
     void writestats(void) {
-	ofstream statsStream(ALGORITHM_NAME, ios::app);
+	ofstream statsStream(algorithmName.c_str(), ios::app);
 	statsStream << levelName
-		    << " with " << ALGORITHM_NAME << " final statistics:\n";
+		    << " with " << algorithmName << " final statistics:\n";
 	Statistics::print(statsStream);
 	if (Statistics::solutionLength != 0) {
 	    statsStream << " Solution length:  " << Statistics::solutionLength << endl;
@@ -68,127 +109,711 @@ extern "C" {
 		statsStream << " Upper bound:      " << Statistics::upperBound << endl;
 	}
     }
+    void stopHelpers(void) {
+	for (vector<pid_t>::const_iterator p = helpers.begin();
+	     p != helpers.end(); ++p)
+	    kill(*p, SIGTERM);
+	for (vector<pid_t>::const_iterator p = helpers.begin();
+	     p != helpers.end(); ++p)
+	    waitpid(*p, NULL, 0);
+    }
     void signalhandler(int) {
+#ifdef USE_IDASTAR
+	if (IDAStarStop())
+	    return;		// it will exit after writing a checkpoint
+#endif
 	exit(1);
     }
 }
 
+#ifdef USE_IDASTAR
+// replace the checkpoint file, so a crash never leaves a partial one
+static void writeCheckpoint(const IDAStarCheckpoint& position) {
+    string tmpName = checkpointFile + ".tmp";
+    {
+	ofstream out(tmpName.c_str());
+	out << checkpointHeader << position;
+	if (!out) {
+	    cerr << "Warning: cannot write " << tmpName << endl;
+	    return;
+	}
+    }
+    if (rename(tmpName.c_str(), checkpointFile.c_str()) != 0)
+	cerr << "Warning: cannot rename " << tmpName << endl;
+    else
+	cout << "Checkpoint written to " << checkpointFile << endl;
+}
+
+static string makeCheckpointHeader(const Level& level, int goalNr) {
+    ostringstream header;
+    header << "level " << hex << level.hash() << dec << '\n'
+	   << "goal " << level.goalPos(goalNr) << '\n';
+    return header.str();
+}
+
+// IDA*_CR: the next bound above provenBound, chosen so that the next round
+// expands about ratio times as many nodes as the last one, which expanded
+// expanded nodes and cut off cutoffs[f] nodes with f-value f. The nodes
+// cut off up to the bound are taken as what the next round expands in
+// addition.
+static int controlledBound(int provenBound, const vector<uint64_t>& cutoffs,
+			   uint64_t expanded, double ratio) {
+    double wanted = (ratio - 1.0) * expanded;
+    double cutOff = 0;
+    int bound;
+    for (bound = provenBound; bound + 1 < int(cutoffs.size()); ++bound) {
+	cutOff += cutoffs[bound];
+	if (cutOff >= wanted)
+	    break;
+    }
+    return bound;
+}
+#endif
+
+// replay and print a solution for the current goal
+static void printSolution(const deque<Move>& moves, bool optimal = true) {
+    State state(Problem::startPositions());
+    for (deque<Move>::const_iterator m = moves.begin();
+	 m != moves.end(); ++m)
+	state = State(state, *m);
+    assert(state.minMovesLeft() == 0);
+    cout << "Final board:\n"
+	 << Board(state)
+	 << "Solution in " << moves.size() << " moves.\n";
+    for (deque<Move>::const_iterator m = moves.begin();
+	 m != moves.end(); ++m)
+	cout << *m << endl;
+
+    if (optimal)
+	Statistics::solutionLength = moves.size();
+    else
+	Statistics::upperBound = moves.size();
+
+    cout << levelName << " with " << algorithmName
+	 << " final statistics:\n";
+    Statistics::print(cout);
+    LargeMemory::printUsage(cout);
+}
+
+// append a solution to the log of all solutions ever found
+static void logSolution(const deque<Move>& moves) {
+    ofstream solStream("solutions", ios::app);
+    solStream << levelName << ' ' << isotime()
+	      << ' ' << moves.size() << " moves: ";
+    for (deque<Move>::const_iterator m = moves.begin();
+	 m != moves.end(); ++m)
+	solStream << *m << " ";
+    solStream << endl;
+}
+
+// Find the shortest solution in the bounds database. Returns its goal
+// number, or -1 if there is none.
+static int bestKnownSolution(const Level& level, BoundsDatabase& bounds,
+			     deque<Move>& solution) {
+    bounds.reload();
+    int bestGoalNr = -1;
+    for (int goalNr = 0; goalNr < level.numGoals(); ++goalNr) {
+	const BoundsEntry& entry = bounds.entry(level.goalPos(goalNr));
+	if (!entry.solution.empty()
+	    && (bestGoalNr == -1 || entry.solution.size() < solution.size())) {
+	    solution = entry.solution;
+	    bestGoalNr = goalNr;
+	}
+    }
+    return bestGoalNr;
+}
+
+// Look for a solution shorter than solution with WIDA*, and publish it.
+// Returns like WIDAStar().
+static int improveSolution(const Level& level, double weight,
+			   SharedBounds* shared, BoundsDatabase& bounds,
+			   deque<Move>& solution) {
+    double seconds = Statistics::timer.seconds();
+    uint64_t statesGenerated = Statistics::statesGenerated;
+    int goalNr = WIDAStar(level, weight, shared, solution);
+    if (goalNr < 0)
+	return goalNr;
+    cout << "Upper bound from WIDA* with weight " << weight << ": "
+	 << solution.size() << endl;
+    // database first, so whoever sees the new bound can find the solution
+    bounds.update(level.goalPos(goalNr), 0, solution,
+		  Statistics::timer.seconds() - seconds,
+		  Statistics::statesGenerated - statesGenerated);
+    shared->lowerUpperBound(solution.size());
+    logSolution(solution);
+    return goalNr;
+}
+
+// parse a comma-separated list of weights
+static bool parseWeights(const string& list, vector<double>& weights) {
+    istringstream in(list);
+    weights.clear();
+    double weight;
+    while (in >> weight) {
+	if (weight < 1.0)
+	    return false;
+	weights.push_back(weight);
+	char comma;
+	if (!(in >> comma))
+	    return true;
+	if (comma != ',')
+	    return false;
+    }
+    return false;
+}
+
 void usage() {
-    cout << "Usage: atomixer levelfile           solve level" << endl
-	 << "       atomixer --stats levelfile   print statistics" << endl;
+    cout << "Usage: atomixer [options] levelfile  solve level" << endl
+	 << "       atomixer --stats levelfile    print statistics" << endl
+	 << "       atomixer --show levelfile     show level" << endl
+	 << "Options:" << endl
+	 << "  --bounds file  bounds database to use (default: bounds.db)"
+	 << endl
+	 << "  --precomputed dir  where to keep tables computed from the level,"
+	 << endl
+	 << "                 shared with other processes (default: none)"
+	 << endl
+	 << "  --anytime      first find upper bounds with weighted IDA*,"
+	 << endl
+	 << "                 then prove optimality" << endl
+	 << "  --portfolio    run weighted IDA* in separate processes, one"
+	 << endl
+	 << "                 per weight, alongside the optimal search" << endl
+	 << "  --beam width   only find a solution with beam search, keeping"
+	 << endl
+	 << "                 width states per layer" << endl
+	 << "  --nmcs level   only find a solution with nested Monte-Carlo"
+	 << endl
+	 << "                 search of the given level" << endl
+	 << "  --shorten k    only shorten the best known solution by"
+	 << endl
+	 << "                 re-searching every k consecutive moves" << endl
+	 << "  --threads n    threads for --beam, --nmcs and A* (default:"
+	 << endl
+	 << "                 number of CPUs)"
+	 << endl
+	 << "  --memory size  memory for the search tables, like 512M or 6G"
+	 << endl
+	 << "                 (default: " << int(MEMORY_FRACTION * 100)
+	 << "% of what is available)" << endl
+	 << "  --weights w1,w2,...  weights for --anytime (default: "
+	 << DEFAULT_WEIGHTS << ")" << endl
+	 << "                 or --portfolio (default: "
+	 << DEFAULT_PORTFOLIO_WEIGHTS << ")" << endl
+#ifdef USE_IDASTAR
+	 << "  --forward      search from the start toward the goal" << endl
+	 << "  --backward     search from the goal toward the start" << endl
+	 << "  (default: choose per goal by branching factor)" << endl
+	 << "  --resume       continue from levelfile.checkpoint, which is"
+	 << endl
+	 << "                 written periodically and on SIGTERM" << endl
+	 << "  --cr ratio     raise the bound so that each round searches"
+	 << endl
+	 << "                 about ratio times as many nodes (IDA*_CR)"
+	 << endl
+	 << "  --lookahead k  search the last k moves before the bound without"
+	 << endl
+	 << "                 probing the tables (default: " << LOOKAHEAD
+	 << ")" << endl
+	 << "  --coordinator port  hand out the search to workers that"
+	 << endl
+	 << "                 connect to port" << endl
+	 << "  --worker host:port  search for the coordinator at host:port"
+	 << endl
+#endif
+	;
 }
 
 int main(int argc, char* argv[]) {
     try {
-    if (argc < 2 || argc > 3) {
-	usage();
-	return 1;
-    }
+    string mode;
+    string boundsFile = "bounds.db";
+    vector<double> weights;
+    bool portfolio = false;
+    int beamWidth = 0;
+    int nmcsLevel = -1;
+    int shortenWindow = 0;
+    int numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+#ifdef USE_IDASTAR
+    enum { FORWARD, BACKWARD, AUTO } direction = AUTO;
+    bool resume = false;
+    double crRatio = 0;		// 0: raise the bound by one each round
+    int coordinatorPort = 0;	// 0: search here
+    string coordinatorAddress;	// non-empty: be a worker for it
+#endif
 
-    if (argc == 3) {
-	if (string(argv[1]) == "--stats") {
-	    ifstream levelStream(argv[2]);
-	    assert(levelStream);
-	    Level level(levelStream);
-	    level.printStats();
-	} else if (string(argv[1]) == "--show") {
-	    ifstream levelStream(argv[2]);
-	    assert(levelStream);
-	    Level level(levelStream);
-	    cout << level.startBoard() << "Goal:\n" << level.goal();
+    int argNr;
+    for (argNr = 1; argNr < argc && argv[argNr][0] == '-'; ++argNr) {
+	string option = argv[argNr];
+	if (option == "--stats" || option == "--show") {
+	    mode = option;
+	} else if (option == "--bounds" && argNr + 1 < argc) {
+	    boundsFile = argv[++argNr];
+	} else if (option == "--precomputed" && argNr + 1 < argc) {
+	    PrecomputedCache::setDirectory(argv[++argNr]);
+	} else if (option == "--anytime") {
+	    if (weights.empty())
+		parseWeights(DEFAULT_WEIGHTS, weights);
+	} else if (option == "--portfolio") {
+	    portfolio = true;
+	} else if (option == "--beam" && argNr + 1 < argc) {
+	    beamWidth = atoi(argv[++argNr]);
+	    if (beamWidth <= 0) {
+		usage();
+		return 1;
+	    }
+	} else if (option == "--nmcs" && argNr + 1 < argc) {
+	    nmcsLevel = atoi(argv[++argNr]);
+	    if (nmcsLevel < 0) {
+		usage();
+		return 1;
+	    }
+	} else if (option == "--shorten" && argNr + 1 < argc) {
+	    shortenWindow = atoi(argv[++argNr]);
+	    if (shortenWindow < 2) {
+		usage();
+		return 1;
+	    }
+	} else if (option == "--threads" && argNr + 1 < argc) {
+	    numThreads = atoi(argv[++argNr]);
+	    if (numThreads <= 0) {
+		usage();
+		return 1;
+	    }
+	} else if (option == "--memory" && argNr + 1 < argc) {
+	    size_t memory = LargeMemory::parseSize(argv[++argNr]);
+	    if (memory == 0) {
+		usage();
+		return 1;
+	    }
+	    LargeMemory::setBudget(memory);
+	} else if (option == "--weights" && argNr + 1 < argc) {
+	    if (!parseWeights(argv[++argNr], weights)) {
+		cerr << "Bad weights: " << argv[argNr] << endl;
+		return 1;
+	    }
+#ifdef USE_IDASTAR
+	} else if (option == "--forward") {
+	    direction = FORWARD;
+	} else if (option == "--backward") {
+	    direction = BACKWARD;
+	} else if (option == "--resume") {
+	    resume = true;
+	} else if (option == "--cr" && argNr + 1 < argc) {
+	    crRatio = atof(argv[++argNr]);
+	    if (crRatio <= 1.0) {
+		usage();
+		return 1;
+	    }
+	} else if (option == "--lookahead" && argNr + 1 < argc) {
+	    int depth = atoi(argv[++argNr]);
+	    if (depth < 0) {
+		usage();
+		return 1;
+	    }
+	    IDAStarSetLookahead(depth);
+	} else if (option == "--coordinator" && argNr + 1 < argc) {
+	    coordinatorPort = atoi(argv[++argNr]);
+	    if (coordinatorPort <= 0 || coordinatorPort > 65535) {
+		usage();
+		return 1;
+	    }
+	} else if (option == "--worker" && argNr + 1 < argc) {
+	    coordinatorAddress = argv[++argNr];
+#endif
 	} else {
 	    usage();
 	    return 1;
 	}
+    }
+    if (argNr != argc - 1) {
+	usage();
+	return 1;
+    }
+#ifdef USE_IDASTAR
+    // the workers always search up to the bound they are given
+    if (coordinatorPort != 0 && (crRatio > 0 || resume)) {
+	usage();
+	return 1;
+    }
+#endif
+    const char* levelFile = argv[argNr];
 
+    if (mode == "--stats") {
+	ifstream levelStream(levelFile);
+	assert(levelStream);
+	Level level(levelStream);
+	level.printStats();
+	return 0;
+    } else if (mode == "--show") {
+	ifstream levelStream(levelFile);
+	assert(levelStream);
+	Level level(levelStream);
+	cout << level.startBoard() << "Goal:\n" << level.goal();
 	return 0;
     }
 
+    // beam search and nested Monte-Carlo search only give upper bounds
+    bool heuristicOnly = beamWidth > 0 || nmcsLevel >= 0 || shortenWindow > 0;
+    if (shortenWindow > 0) {
+	algorithmName = "shorten";
+    } else if (beamWidth > 0) {
+	algorithmName = "beam";
+    } else if (nmcsLevel >= 0) {
+	algorithmName = "nmcs";
+    } else if (portfolio) {
+	if (weights.empty())
+	    parseWeights(DEFAULT_PORTFOLIO_WEIGHTS, weights);
+	algorithmName += "-portfolio";
+    } else if (!weights.empty()) {
+	algorithmName += "-anytime";
+    }
+#ifdef USE_IDASTAR
+    // the heuristic searches always go forward
+    if (!heuristicOnly && direction == BACKWARD)
+	algorithmName += "-backward";
+    else if (!heuristicOnly && direction == AUTO)
+	algorithmName += "-autodir";
+    if (!heuristicOnly && crRatio > 0)
+	algorithmName += "-cr";
+    if (!coordinatorAddress.empty())
+	algorithmName += "-worker";
+    else if (!heuristicOnly && coordinatorPort != 0)
+	algorithmName += "-distributed";
+#elif !defined(USE_FRINGE)
+    if (!heuristicOnly && numThreads > 1)
+	algorithmName += "-hda";
+#endif
+
     atexit(writestats);
     signal(SIGTERM, signalhandler);
+    signal(SIGXCPU, signalhandler);	// CPU limit of atomixer-batch
 
-    ifstream levelStream(argv[1]);
+    ifstream levelStream(levelFile);
     assert(levelStream);
     Level level(levelStream);
     cout << level.startBoard();
     Problem::setLevel(level);
 
-    levelName = string(argv[1]);
+    levelName = string(levelFile);
     while (levelName.find('/') != string::npos)
 	levelName = levelName.substr(levelName.find('/') + 1);
-    cout << "Solving " << levelName << "...\n";
+#ifdef USE_IDASTAR
+    if (!coordinatorAddress.empty()) {
+	distributedWorker(level, coordinatorAddress);
+	return 0;
+    }
+#endif
+    cout << "Solving " << levelName << " with "
+	 << LargeMemory::budget() / (1024 * 1024) << " MB for the tables...\n";
+
+#ifdef USE_IDASTAR
+    checkpointFile = levelName + ".checkpoint";
+    IDAStarSetCheckpointHandler(writeCheckpoint, CHECKPOINT_INTERVAL);
+
+    // the checkpoint is used when its goal and bound come up
+    int resumeGoalNr = -1;
+    IDAStarCheckpoint resumePosition;
+    if (resume) {
+	ifstream in(checkpointFile.c_str());
+	string levelTag, goalTag;
+	uint64_t levelHash;
+	Pos goalPos;
+	if (!(in >> levelTag >> hex >> levelHash >> dec >> goalTag >> goalPos
+	      >> resumePosition) || levelTag != "level" || goalTag != "goal") {
+	    cerr << "Cannot read checkpoint " << checkpointFile << endl;
+	    return 1;
+	}
+	for (int goalNr = 0; goalNr < level.numGoals(); ++goalNr)
+	    if (level.goalPos(goalNr) == goalPos)
+		resumeGoalNr = goalNr;
+	if (levelHash != level.hash() || resumeGoalNr == -1) {
+	    cerr << "Checkpoint " << checkpointFile
+		 << " is for a different level" << endl;
+	    return 1;
+	}
+    }
+
+    // -1 means not decided yet
+    vector<int> goalBackward(level.numGoals(), direction == AUTO ? -1
+			     : direction == BACKWARD);
+#endif
+
+    BoundsDatabase bounds(boundsFile, level, levelName);
+
+    // Lower bound for the solution length for each goal. It starts out as
+    // the heuristic estimate from either side or what earlier runs proved,
+    // and is raised to the smallest f-value cut off whenever a search
+    // fails. Goals whose bound is above the current maxMoves need not be
+    // searched.
+    vector<int> goalLowerBound(level.numGoals());
+    for (int goalNr = 0; goalNr < level.numGoals(); ++goalNr) {
+	Problem::setGoal(level, goalNr);
+	goalLowerBound[goalNr]
+	    = max(max(State(Problem::startPositions()).minMovesLeft(),
+		      State(Problem::rstartPositions()).rminMovesLeft()),
+		  bounds.entry(level.goalPos(goalNr)).lowerBound);
+    }
+    deque<Move> knownSolution;
+    int knownSolutionGoalNr = bestKnownSolution(level, bounds, knownSolution);
+    int knownLowerBound = *min_element(goalLowerBound.begin(),
+				       goalLowerBound.end());
+    cout << "Lower bound from heuristic and bounds database: "
+	 << knownLowerBound << endl;
+    if (!knownSolution.empty()) {
+	Statistics::upperBound = knownSolution.size();
+	cout << "Known solution: " << knownSolution.size() << " moves\n";
+    }
+    SharedBounds* shared = SharedBounds::create(
+	knownLowerBound, knownSolution.empty() ? INT_MAX : knownSolution.size());
 
-    int knownLowerBound = 0;
+    if (shortenWindow > 0) {
+	if (knownSolution.empty()) {
+	    cerr << "No known solution for " << levelName << " to shorten"
+		 << endl;
+	    return 1;
+	}
+	Problem::setGoal(level, knownSolutionGoalNr);
+	deque<Move> moves = shortenSolution(knownSolution, shortenWindow);
+	if (moves.size() < knownSolution.size()) {
+	    cout << "Upper bound from shortening: " << moves.size() << endl;
+	    bounds.update(level.goalPos(knownSolutionGoalNr), 0, moves,
+			  Statistics::timer.seconds(),
+			  Statistics::statesGenerated);
+	    logSolution(moves);
+	}
+	printSolution(moves, int(moves.size()) <= knownLowerBound);
+	return 0;
+    }
 
-    for (int maxMoves = knownLowerBound; ; ++maxMoves) {
+    if (heuristicOnly) {
+	// no proof, just a solution that is as good as possible
+	for (int goalNr = 0; goalNr < level.numGoals(); ++goalNr) {
+	    int maxLength = knownSolution.empty()
+		? MAX_HEURISTIC_LENGTH : int(knownSolution.size()) - 1;
+	    if (goalLowerBound[goalNr] > maxLength)
+		continue;
+	    cout << (beamWidth > 0 ? "Beam" : "Nested Monte-Carlo")
+		 << " search for goal " << level.goalPos(goalNr) << endl;
+	    Problem::setGoal(level, goalNr);
+	    double seconds = Statistics::timer.seconds();
+	    uint64_t statesGenerated = Statistics::statesGenerated;
+	    deque<Move> moves = beamWidth > 0
+		? beamSearch(beamWidth, maxLength, LargeMemory::budget(),
+			     numThreads)
+		: nestedMonteCarlo(nmcsLevel, maxLength, numThreads);
+	    if (moves.empty())
+		continue;
+	    knownSolution = moves;
+	    knownSolutionGoalNr = goalNr;
+	    cout << "Upper bound from " << algorithmName << " search: "
+		 << moves.size() << endl;
+	    bounds.update(level.goalPos(goalNr), 0, moves,
+			  Statistics::timer.seconds() - seconds,
+			  Statistics::statesGenerated - statesGenerated);
+	    logSolution(moves);
+	}
+	if (knownSolution.empty()) {
+	    cout << "No solution found for " << levelName << endl;
+	    return 1;
+	}
+	Problem::setGoal(level, knownSolutionGoalNr);
+	printSolution(knownSolution, int(knownSolution.size()) <= knownLowerBound);
+	return 0;
+    }
+
+    if (portfolio) {
+	// each weight gets a process of its own, running alongside the
+	// optimal search below; they are stopped when we exit, or die
+	atexit(stopHelpers);
+	pid_t parent = getpid();
+	for (vector<double>::const_iterator w = weights.begin();
+	     w != weights.end(); ++w) {
+	    cout.flush();
+	    pid_t pid = fork();
+	    if (pid < 0) {
+		cerr << "Cannot fork" << endl;
+		return 1;
+	    }
+	    if (pid == 0) {
+		helpers.clear();	// the others are not ours to stop
+		signal(SIGTERM, SIG_DFL);
+		prctl(PR_SET_PDEATHSIG, SIGTERM);
+		if (getppid() != parent)	// too late for that
+		    _exit(0);
+		while (improveSolution(level, *w, shared, bounds,
+				       knownSolution) >= 0) { }
+		cout.flush();
+		_exit(0);
+	    }
+	    helpers.push_back(pid);
+	}
+    } else {
+	// upper bounds first, so there is an answer if the proof takes long
+	for (vector<double>::const_iterator w = weights.begin();
+	     w != weights.end() && !shared->solved(); ++w) {
+	    int goalNr = improveSolution(level, *w, shared, bounds,
+					 knownSolution);
+	    if (goalNr >= 0)
+		knownSolutionGoalNr = goalNr;
+	}
+    }
+
+#ifdef USE_IDASTAR
+    IDAStarSetBounds(shared);
+    if (coordinatorPort != 0)
+	distributedListen(coordinatorPort, level.hash());
+    // what the last round cut off, for IDA*_CR
+    vector<uint64_t> roundCutoffs;
+    uint64_t roundExpanded = 0;
+#endif
+    for (int maxMoves = max(knownLowerBound, int(shared->lowerBound)); ; ) {
+	shared->raiseLowerBound(maxMoves);
+	if (shared->solved()) {
+	    // no goal has a shorter solution than the best known one
+	    knownSolutionGoalNr
+		= bestKnownSolution(level, bounds, knownSolution);
+	    cout << "Known solution is optimal.\n";
+	    Problem::setGoal(level, knownSolutionGoalNr);
+	    printSolution(knownSolution);
+	    return 0;
+	}
+#ifdef USE_IDASTAR
+	// no solution is shorter than provenBound, but with IDA*_CR, the
+	// round may search beyond it; then a solution found is only known
+	// to be optimal once all goals have been searched up to its length
+	int provenBound = maxMoves;
+	if (crRatio > 0 && !roundCutoffs.empty())
+	    maxMoves = min(controlledBound(provenBound, roundCutoffs,
+					   roundExpanded, crRatio),
+			   shared->upperBound - 1);
+	else if (crRatio > 0 && resumeGoalNr != -1
+		 && resumePosition.maxMoves > maxMoves)
+	    // the cutoffs of the round the checkpoint was written in are
+	    // gone, so repeat its bound
+	    maxMoves = min(resumePosition.maxMoves, shared->upperBound - 1);
+	IDAStarSetProvenBound(provenBound);
+	roundCutoffs.clear();
+	roundExpanded = Statistics::statesExpanded;
+	deque<Move> roundSolution;
+	int roundSolutionGoalNr = -1;
+#endif
 	cout << "******************** " << maxMoves << " ********************\n";
 	for (int goalNr = 0; goalNr < level.numGoals(); ++goalNr) {
+	    if (goalLowerBound[goalNr] > maxMoves)
+		continue;
+	    if (shared->solved())
+		break;
 	    cout << "-------------------- "
 		 << maxMoves << ": " << level.goalPos(goalNr)
 		 << " --------------------\n";
 	    Problem::setGoal(level, goalNr);
-	    State start(Problem::startPositions());
+	    double seconds = Statistics::timer.seconds();
+	    uint64_t statesGenerated = Statistics::statesGenerated;
+	    int nextMaxMoves;
 #ifdef USE_IDASTAR
-	    deque<Move> moves = IDAStar(maxMoves);
+	    const IDAStarCheckpoint* resumeFrom = NULL;
+	    if (goalNr == resumeGoalNr && maxMoves == resumePosition.maxMoves) {
+		goalBackward[goalNr] = resumePosition.backward;
+		resumeFrom = &resumePosition;
+		resumeGoalNr = -1;
+	    } else if (goalNr == resumeGoalNr
+		       && maxMoves > resumePosition.maxMoves) {
+		cerr << "Warning: checkpoint is for bound "
+		     << resumePosition.maxMoves << ", below this search's; "
+		     << "ignoring it" << endl;
+		resumeGoalNr = -1;
+	    }
+	    if (goalBackward[goalNr] == -1) {
+		goalBackward[goalNr] = IDAStarPreferBackward();
+		cout << "Searching " << (goalBackward[goalNr]
+					 ? "backward" : "forward")
+		     << " for this goal.\n";
+	    }
+	    checkpointHeader = makeCheckpointHeader(level, goalNr);
+	    deque<Move> moves = coordinatorPort != 0
+		? distributedIDAStar(maxMoves, goalBackward[goalNr], shared,
+				     &nextMaxMoves)
+		: IDAStar(maxMoves, goalBackward[goalNr], &nextMaxMoves,
+			  resumeFrom);
+	    // the bounds database has the rest, unless the checkpoint is for a
+	    // search still to come
+	    if (resumeGoalNr == -1)
+		remove(checkpointFile.c_str());
+	    const vector<uint64_t>& cutoffs = IDAStarCutoffs();
+	    if (roundCutoffs.size() < cutoffs.size())
+		roundCutoffs.resize(cutoffs.size());
+	    for (size_t f = 0; f < cutoffs.size(); ++f)
+		roundCutoffs[f] += cutoffs[f];
+#elif defined(USE_FRINGE)
+	    deque<Move> moves = fringeSearch(State(Problem::startPositions()),
+					     maxMoves, &nextMaxMoves);
 #else
-	    deque<Move> moves = aStar2(start, maxMoves);
+	    deque<Move> moves = numThreads > 1
+		? hdaStar(State(Problem::startPositions()), maxMoves,
+			  &nextMaxMoves, numThreads)
+		: aStar2(State(Problem::startPositions()), maxMoves,
+			 &nextMaxMoves);
+#endif
+	    seconds = Statistics::timer.seconds() - seconds;
+	    statesGenerated = Statistics::statesGenerated - statesGenerated;
+#ifdef USE_IDASTAR
+	    if (int(moves.size()) > provenBound) {
+		// the shortest for this goal; the others only need to be
+		// searched for shorter ones
+		bounds.update(level.goalPos(goalNr), moves.size(), moves,
+			      seconds, statesGenerated);
+		logSolution(moves);
+		shared->lowerUpperBound(moves.size());
+		roundSolution = moves;
+		roundSolutionGoalNr = goalNr;
+		maxMoves = moves.size() - 1;
+		continue;
+	    }
 #endif
 	    if (moves.size() > 0) {
-		State state = start;
-#ifndef DO_BACKWARD_SEARCH
-		for (deque<Move>::const_iterator m = moves.begin();
-		     m != moves.end(); ++m) {
-		    state = State(state, *m);
-		    //cout << Board(state);
-		}
-#else
-		cout << "Found solution.\n"
-		     << Board(state);
-		// Bug in g++: const_reverse_iterator doesn't work
-		for (deque<Move>::reverse_iterator m = moves.rbegin();
-		     m != moves.rend(); ++m) {
-		    cout << *m << endl;
-		    state.undo(*m);
-		    cout << Board(state);
-		}
-#endif
-		cout << "Final board:\n"
-		     << Board(state)
-		     << "Solution in " << moves.size() << " moves.\n";
-		for (deque<Move>::const_iterator m = moves.begin();
-		     m != moves.end(); ++m) {
-		    cout << *m << endl;
-		}
-
-		Statistics::solutionLength = moves.size();
-		
-		cout << levelName << " with " << ALGORITHM_NAME
-		     << " final statistics:\n";
-		Statistics::print(cout);
-
-
-		ofstream boundStream("bounds", ios::app);
-		boundStream << levelName << ": = " << maxMoves << endl;
-
-		ofstream solStream("solutions", ios::app);
-		solStream << levelName << ' ' << isotime()
-			  << ' ' << moves.size() << " moves: ";
-		for (deque<Move>::const_iterator m = moves.begin();
-		     m != moves.end(); ++m)
-		    solStream << *m << " ";
-		solStream << endl;
-
+		bounds.update(level.goalPos(goalNr), maxMoves, moves,
+			      seconds, statesGenerated);
+		printSolution(moves);
+		logSolution(moves);
 		return 0;
 	    }
+#ifdef USE_IDASTAR
+	    // A search stopped because the bounds were solved elsewhere
+	    // returns maxMoves, but with IDA*_CR only provenBound is proven.
+	    if (shared->solved())
+		nextMaxMoves = min(nextMaxMoves, provenBound);
+#endif
+	    goalLowerBound[goalNr] = nextMaxMoves;
+	    bounds.update(level.goalPos(goalNr), nextMaxMoves, deque<Move>(),
+			  seconds, statesGenerated);
 	}
-	// ok, now we know we need at least maxMoves + 1 moves
-	Statistics::lowerBound = maxMoves + 1;
-	if (maxMoves + 1 > knownLowerBound) {
-	    ofstream boundStream("bounds", ios::app);
-	    boundStream << levelName << ": >= " << maxMoves + 1 << endl;
-	    cout << "New lower bound found for " << levelName
-		 << ": " << maxMoves + 1 << endl;
+#ifdef USE_IDASTAR
+	roundExpanded = Statistics::statesExpanded - roundExpanded;
+	if (!roundSolution.empty() && !shared->solved()) {
+	    cout << "Solution is optimal.\n";
+	    Problem::setGoal(level, roundSolutionGoalNr);
+	    printSolution(roundSolution);
+	    return 0;
 	}
+#endif
+	if (shared->solved())
+	    continue;
+	if (shared->upperBound != INT_MAX)
+	    Statistics::upperBound = shared->upperBound;
+	// ok, now we know we need at least as many moves as the smallest
+	// bound of any goal
+	int lowerBound = *min_element(goalLowerBound.begin(),
+				      goalLowerBound.end());
+	if (lowerBound == INT_MAX) {
+	    cout << "No solution for " << levelName << endl;
+	    return 1;
+	}
+	Statistics::lowerBound = lowerBound;
+	if (lowerBound > knownLowerBound)
+	    cout << "New lower bound found for " << levelName
+		 << ": " << lowerBound << endl;
+	maxMoves = lowerBound;
     }
     } catch (const std::exception& e) {
 	cout << "Caught exception: " << e.what() << endl;
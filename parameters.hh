@@ -22,12 +22,28 @@
 #ifndef PARAMETERS_HH
 #define PARAMETERS_HH
 
-// maximum amount of memory to be used
+// unless --memory says otherwise, the search tables use this share of the
+// memory available, or MEMORY if that can't be found out
+static const double MEMORY_FRACTION = 0.75;
 static const unsigned long MEMORY = 7UL * 1024UL * 1024UL * 1024UL;
 
-// define if you're sure your OS returns fresh pages zeroed (like Linux, but
-// unlike Solaris)
-#undef MY_OS_ZEROES_LARGE_MEMORY_ALLOCATIONS
-//#define MY_OS_ZEROES_LARGE_MEMORY_ALLOCATIONS
+// the disk tier of the IDA* cache (DO_DISK_CACHING): where it goes, how
+// large it is, and how far from the root states are stored in it
+static const char* const DISK_CACHE_FILE = "atomixer.cache";
+static const unsigned long DISK_CACHE_SIZE = 64UL * 1024UL * 1024UL * 1024UL;
+static const int DISK_CACHE_MAX_DEPTH = 8;
+
+// IDA* searches nodes this close to the bound without probing its tables.
+// Most children there are cut off by the bound before any probe, so on the
+// levels tried, this made no measurable difference either way.
+static const int LOOKAHEAD = 0;
+
+// how often a long search writes a checkpoint, in seconds
+static const int CHECKPOINT_INTERVAL = 10 * 60;
+
+// The coordinator of distributed IDA* splits each iteration into at least
+// this many subtrees, so that they can be spread evenly over the workers
+// even though their sizes vary a lot.
+static const unsigned FRONTIER_NODES = 2000;
 
 #endif